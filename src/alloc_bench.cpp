@@ -0,0 +1,136 @@
+// Steady-state allocation check: plays the game headless with scripted input,
+// rendering through the CpuRasterizer, and counts heap allocations per frame.
+// After the warm-up frames no frame may allocate; the frames that do are
+// listed by phase and the exit code is 1. It is 1 as well when the frames
+// after warm-up didn't cover a new round, a crash and a restart.
+//
+// Usage: alloc_bench [frames] [warm-up frames] [--debug]
+// --debug turns on the debug overlay (collision lines, asteroid IDs).
+
+#include <SFML/Graphics.hpp>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "alloc_tracker.hpp"
+#include "game.hpp"
+#include "raster.hpp"
+#include "util.hpp"
+
+int main(int argc, char** argv) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  bool debug = std::erase(args, "--debug") > 0;
+  int frames = args.size() > 0 ? std::stoi(args[0]) : 3000;
+  int warmup = args.size() > 1 ? std::stoi(args[1]) : 600;
+
+  const unsigned width = 1920, height = 1080;
+  CpuRasterizer rasterizer(width, height);
+  sf::View view;
+  view.setCenter(0, 0);
+  view.setSize(static_cast<float>(width), static_cast<float>(height));
+  rasterizer.setView(view);
+
+  Game game(view.getSize());
+  game.debug = debug;
+  TextDrawer textDrawer;
+
+  // The same pre-sizing the game does, so a new high water mark after
+  // warm-up is a real steady-state allocation
+  game.reserve(textDrawer);
+
+  // The game logs to stdout, keep it quiet while playing
+  std::cout.setstate(std::ios::failbit);
+
+  struct Failure {
+    long frame;
+    AllocationTracker::Frame allocations;
+  };
+  std::vector<Failure> failures;
+  failures.reserve(frames);
+  AllocationTracker::Stats warmupTotal;
+  int rounds = 0, crashes = 0, restarts = 0;
+
+  AllocationTracker::takeFrame();
+  for (int f = 0; f < warmup + frames; ++f) {
+    // Spin and shoot for 600 frames, which clears rounds, then turn to the
+    // nearest asteroid and fly into it, so the game over and restart paths
+    // run too. Asteroids are shot on the way, but the ship speeds up faster
+    // than they go.
+    Input input;
+    input.shoot = f % 6 == 0;
+    input.restart = f % 100 == 0;
+    if (f % 1200 < 600 || game.asteroids.empty()) {
+      input.left = true;
+      input.thrust = f % 240 < 90;
+    } else {
+      auto shipPos = game.ship.shape.getPosition();
+      auto target = game.asteroids[0].shape.getPosition();
+      for (const auto& asteroid : game.asteroids) {
+        auto pos = asteroid.shape.getPosition();
+        if (magnitude(pos - shipPos) < magnitude(target - shipPos)) {
+          target = pos;
+        }
+      }
+      auto d = target - shipPos;
+      float heading = std::atan2(d.y, d.x) * 180 / 3.14159265f + 90;
+      float turn = std::remainder(heading - game.ship.shape.getRotation(), 360);
+      input.left = turn < -2;
+      input.right = turn > 2;
+      input.thrust = std::abs(turn) < 30;
+    }
+
+    bool playing = game.resetFrame < frame;
+    bool restarting = game.resetFrame == frame;
+    int roundSize = game.numAsteroids;
+
+    AllocationTracker::setPhase("update");
+    game.update(input, textDrawer);
+    if (f >= warmup) {
+      rounds += game.numAsteroids > roundSize;
+      crashes += playing && game.resetFrame > frame;
+      restarts += restarting;
+    }
+
+    AllocationTracker::setPhase("draw");
+    rasterizer.clear(sf::Color::Black);
+    game.draw(rasterizer, textDrawer);
+
+    AllocationTracker::setPhase("display");
+    drawer.display(rasterizer);
+    textDrawer.display(rasterizer);
+    rasterizer.display();
+
+    AllocationTracker::setPhase("other");
+    auto allocations = AllocationTracker::takeFrame();
+    auto total = AllocationTracker::total(allocations);
+    if (f < warmup) {
+      warmupTotal.count += total.count;
+      warmupTotal.bytes += total.bytes;
+    } else if (total.count > 0) {
+      failures.push_back({frame, allocations});
+    }
+    ++frame;
+  }
+
+  std::cout.clear();
+  print("warm-up: ", warmup, " frames, ", warmupTotal.count, " allocations (",
+        warmupTotal.bytes, " bytes)");
+  print("steady state: ", frames, " frames, ", failures.size(),
+        " allocating, ", rounds, " new rounds, ", crashes, " crashes, ",
+        restarts, " restarts");
+  for (const auto& failure : failures) {
+    for (int i = 0; i < AllocationTracker::numPhases; ++i) {
+      const auto& stats = failure.allocations[i];
+      if (stats.count > 0) {
+        print("  frame ", failure.frame, " ", AllocationTracker::phaseNames[i],
+              ": ", stats.count, " allocations (", stats.bytes, " bytes)");
+      }
+    }
+  }
+  if (rounds == 0 || crashes == 0 || restarts == 0) {
+    print("not every path ran, more frames are needed");
+    return 1;
+  }
+  return failures.empty() ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+// Counts heap allocations by replacing the global operator new. Include this
+// header from exactly one translation unit of an executable, it defines the
+// replacement operators.
+//
+// Allocations are attributed to the current frame phase, set with
+// AllocationTracker::setPhase(). takeFrame() returns the per-phase counts
+// since its last call, so calling it once per frame gives per-frame counts.
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+struct AllocationTracker {
+  static constexpr int MAX_PHASES = 8;
+
+  struct Stats {
+    std::size_t count = 0;
+    std::size_t bytes = 0;
+  };
+
+  using Frame = std::array<Stats, MAX_PHASES>;
+
+  // Phase 0 collects allocations made before the first setPhase() call and
+  // those made after more than MAX_PHASES - 1 phases were registered
+  static inline const char* phaseNames[MAX_PHASES] = {"other"};
+  static inline int numPhases = 1;
+  static inline std::atomic<int> phase = 0;
+  static inline std::atomic<std::size_t> counts[MAX_PHASES];
+  static inline std::atomic<std::size_t> bytes[MAX_PHASES];
+
+  static void record(std::size_t size) {
+    int p = phase.load(std::memory_order_relaxed);
+    counts[p].fetch_add(1, std::memory_order_relaxed);
+    bytes[p].fetch_add(size, std::memory_order_relaxed);
+  }
+
+  // Attributes the following allocations to the named phase, registering it
+  // on first use. Not thread safe, call it from the main loop only.
+  static void setPhase(const char* name) {
+    for (int i = 0; i < numPhases; ++i) {
+      if (std::strcmp(phaseNames[i], name) == 0) {
+        phase = i;
+        return;
+      }
+    }
+    if (numPhases == MAX_PHASES) {
+      phase = 0;
+      return;
+    }
+    phaseNames[numPhases] = name;
+    phase = numPhases++;
+  }
+
+  // Per-phase stats since the last call, indexed like phaseNames
+  static Frame takeFrame() {
+    Frame frame;
+    for (int i = 0; i < MAX_PHASES; ++i) {
+      frame[i].count = counts[i].exchange(0, std::memory_order_relaxed);
+      frame[i].bytes = bytes[i].exchange(0, std::memory_order_relaxed);
+    }
+    return frame;
+  }
+
+  static Stats total(const Frame& frame) {
+    Stats sum;
+    for (const auto& stats : frame) {
+      sum.count += stats.count;
+      sum.bytes += stats.bytes;
+    }
+    return sum;
+  }
+};
+
+// Replacement functions can't be inline, hence the one translation unit rule.
+// The nothrow and array forms all forward to these by default. GCC flags a
+// free() it sees inlined after a new as mismatched, so the deletes that
+// free aren't inlined, and the sized ones (which GCC wants defined along
+// with the unsized ones) forward to them.
+
+void* operator new(std::size_t size) {
+  AllocationTracker::record(size);
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  AllocationTracker::record(size);
+  return std::malloc(size ? size : 1);
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { ::operator delete(p); }
+
+// Over-aligned types (alignas larger than the default) come through these.
+// MSVC has no aligned_alloc(), and its aligned blocks need their own free.
+
+void* alignedAlloc(std::size_t size, std::align_val_t alignment) noexcept {
+  auto align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+  return _aligned_malloc(size ? size : 1, align);
+#else
+  // aligned_alloc() wants the size to be a multiple of the alignment
+  std::size_t rounded = size ? (size + align - 1) / align * align : align;
+  return std::aligned_alloc(align, rounded);
+#endif
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  AllocationTracker::record(size);
+  if (void* p = alignedAlloc(size, alignment)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+  AllocationTracker::record(size);
+  return alignedAlloc(size, alignment);
+}
+
+[[gnu::noinline]] void operator delete(void* p, std::align_val_t) noexcept {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept {
+  ::operator delete(p, alignment);
+}
@@ -0,0 +1,329 @@
+// Multiplayer client. Sends input to the server every tick and renders the
+// received snapshots INTERP_DELAY_TICKS in the past, interpolating between
+// the two snapshots around that time.
+//
+// Usage: client [host] [port]
+//        client --bots <count> [seconds] [host] [port]
+// With --bots, runs that many simulated clients without a window, each with
+// its own socket, and reports bandwidth and decode stats every second.
+
+#include <SFML/Graphics.hpp>
+#include <SFML/Network.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "game.hpp"
+#include "net.hpp"
+#include "util.hpp"
+
+const int INTERP_DELAY_TICKS = 3 * SNAPSHOT_INTERVAL;  // 100ms
+
+// Network side of a client, shared by the window client and the bots
+struct Connection {
+  sf::UdpSocket socket;
+  sf::IpAddress server;
+  unsigned short port;
+  SnapshotHistory history;
+  SnapshotAssembler assembler;
+  ByteWriter writer;
+
+  uint32_t playerId = 0;
+  uint32_t latestTick = 0;
+  std::chrono::high_resolution_clock::time_point latestTime;
+
+  std::size_t bytesReceived = 0;
+  std::size_t snapshotsDecoded = 0;
+  std::size_t snapshotsDropped = 0;
+
+  Connection(sf::IpAddress server, unsigned short port,
+             std::size_t historySize = SNAPSHOT_HISTORY)
+      : server(server), port(port), history(historySize) {
+    socket.bind(sf::Socket::AnyPort);
+    socket.setBlocking(false);
+  }
+
+  void send(uint8_t action) {
+    writer.bytes.clear();
+    writer.u8(INPUT);
+    writer.varint(latestTick);
+    writer.u8(action);
+    socket.send(writer.bytes.data(), writer.bytes.size(), server, port);
+  }
+
+  void disconnect() {
+    uint8_t message = DISCONNECT;
+    socket.send(&message, 1, server, port);
+  }
+
+  void receive() {
+    static uint8_t buffer[sf::UdpSocket::MaxDatagramSize];
+    std::size_t received;
+    sf::IpAddress address;
+    unsigned short remotePort;
+    while (socket.receive(buffer, sizeof(buffer), received, address,
+                          remotePort) == sf::Socket::Done) {
+      bytesReceived += received;
+      ByteReader in(buffer, received);
+      uint8_t type = in.u8();
+      if (type == SNAPSHOT) {
+        decode(in);
+      } else if (type == SNAPSHOT_PART) {
+        if (const std::vector<uint8_t>* message = assembler.add(in)) {
+          ByteReader whole(message->data(), message->size());
+          whole.u8();
+          decode(whole);
+        }
+      }
+    }
+  }
+
+  // Reads a SNAPSHOT message after its type byte
+  void decode(ByteReader& in) {
+    Snapshot snapshot;
+    // Out of order packets older than the newest one are still stored if
+    // their slot holds an older tick, the interpolation can use them
+    if (!readSnapshot(in, history, playerId, snapshot)) {
+      ++snapshotsDropped;
+      return;
+    }
+    ++snapshotsDecoded;
+    history.store(snapshot);
+    if (snapshot.tick > latestTick) {
+      latestTick = snapshot.tick;
+      latestTime = now();
+    }
+  }
+
+  // Server tick being shown, in fractional ticks
+  float renderTick() const {
+    std::chrono::duration<float> since = now() - latestTime;
+    return latestTick + since.count() * TICK_RATE - INTERP_DELAY_TICKS;
+  }
+
+  // Snapshots just before and just after tick, either may be null
+  std::pair<const Snapshot*, const Snapshot*> around(float tick) const {
+    const Snapshot* before = nullptr;
+    const Snapshot* after = nullptr;
+    for (const auto& slot : history.slots) {
+      if (slot.tick == 0) {
+        continue;
+      }
+      if (slot.tick <= tick && (!before || slot.tick > before->tick)) {
+        before = &slot;
+      }
+      if (slot.tick > tick && (!after || slot.tick < after->tick)) {
+        after = &slot;
+      }
+    }
+    return {before, after};
+  }
+};
+
+template <typename State>
+const State* findEntity(const std::vector<State>& states, uint32_t id) {
+  auto it = std::lower_bound(
+      states.begin(), states.end(), id,
+      [](const State& s, uint32_t id) { return s.id < id; });
+  return it != states.end() && it->id == id ? &*it : nullptr;
+}
+
+// X and Y are the first two fields of every entity type
+template <typename State>
+sf::Vector2f interpolatedPosition(const State& a, const State* b, float t) {
+  if (!b) {
+    return {dequantizePosition(a.fields[0]), dequantizePosition(a.fields[1])};
+  }
+  return {interpolatePosition(a.fields[0], b->fields[0], t, FIELD_SIZE.x),
+          interpolatePosition(a.fields[1], b->fields[1], t, FIELD_SIZE.y)};
+}
+
+int runClient(sf::IpAddress host, unsigned short port) {
+  auto window = sf::RenderWindow{{1920u, 1080u}, "Asteroids Online"};
+  window.setFramerateLimit(144);
+  sf::View view;
+  view.setCenter(0, 0);
+  view.setSize(FIELD_SIZE);
+  window.setView(view);
+
+  TextDrawer textDrawer("../../open-sans/OpenSans-Regular.ttf");
+  Connection connection(host, port);
+
+  Ship ship;
+  Bullet bullet({0, 0}, 0);
+  std::unordered_map<uint32_t, sf::ConvexShape> asteroidShapes;
+  bool shootPending = false;
+  auto tickDuration = std::chrono::nanoseconds(1'000'000'000 / TICK_RATE);
+  auto nextSend = now();
+
+  while (window.isOpen()) {
+    for (auto event = sf::Event{}; window.pollEvent(event);) {
+      if (event.type == sf::Event::Closed ||
+          (event.type == sf::Event::KeyPressed &&
+           event.key.code == sf::Keyboard::Escape)) {
+        connection.disconnect();
+        window.close();
+      } else if (event.type == sf::Event::KeyPressed &&
+                 event.key.code == sf::Keyboard::Space) {
+        shootPending = true;
+      }
+    }
+
+    if (now() >= nextSend) {
+      uint8_t action = 0;
+      if (sf::Keyboard::isKeyPressed(sf::Keyboard::W)) action |= INPUT_THRUST;
+      if (sf::Keyboard::isKeyPressed(sf::Keyboard::A)) action |= INPUT_LEFT;
+      if (sf::Keyboard::isKeyPressed(sf::Keyboard::D)) action |= INPUT_RIGHT;
+      if (shootPending) action |= INPUT_SHOOT;
+      shootPending = false;
+      connection.send(action);
+      nextSend += tickDuration;
+    }
+    connection.receive();
+
+    window.clear(sf::Color::Black);
+    float renderTick = connection.renderTick();
+    auto [from, to] = connection.around(renderTick);
+    if (!from) {
+      from = to;
+    }
+    if (from) {
+      float t = to && to != from
+                    ? (renderTick - from->tick) / (to->tick - from->tick)
+                    : 0;
+
+      for (const auto& state : from->bullets) {
+        bullet.shape.setPosition(bulletPosition(state, renderTick));
+        bullet.shape.setRotation(
+            to_degrees(std::atan2(state.fields[BULLET_VY],
+                                  state.fields[BULLET_VX])) + 90);
+        window.draw(bullet.shape);
+      }
+
+      for (const auto& state : from->asteroids) {
+        auto it = asteroidShapes.find(state.id);
+        if (it == asteroidShapes.end()) {
+          it = asteroidShapes.emplace(state.id, makeAsteroidShape(state)).first;
+        }
+        it->second.setPosition(interpolatedPosition(
+            state, to ? findEntity(to->asteroids, state.id) : nullptr, t));
+        window.draw(it->second);
+      }
+      // Asteroids only ever disappear, drop shapes that are gone
+      if (asteroidShapes.size() > 2 * from->asteroids.size() + 64) {
+        std::erase_if(asteroidShapes, [&](const auto& entry) {
+          return !findEntity(from->asteroids, entry.first);
+        });
+      }
+
+      for (const auto& state : from->ships) {
+        if (!state.fields[SHIP_ALIVE]) {
+          continue;
+        }
+        const ShipState* next = to ? findEntity(to->ships, state.id) : nullptr;
+        ship.shape.setPosition(interpolatedPosition(state, next, t));
+        ship.shape.setRotation(
+            next ? interpolateRotation(state.fields[SHIP_ROTATION],
+                                       next->fields[SHIP_ROTATION], t)
+                 : dequantizeRotation(state.fields[SHIP_ROTATION]));
+        ship.shape.setOutlineColor(state.id == connection.playerId
+                                       ? sf::Color::White
+                                       : sf::Color(120, 120, 140));
+        window.draw(ship.shape);
+      }
+
+      if (const ShipState* me = findEntity(from->ships, connection.playerId)) {
+        textDrawer.draw(vec(-FIELD_SIZE.x / 2 + 90, -FIELD_SIZE.y / 2 + 35),
+                        "Score: ", me->fields[SHIP_SCORE]);
+        if (!me->fields[SHIP_ALIVE]) {
+          textDrawer.draw({.pos = vec(-100, 0), .size = 24}, "Respawning...");
+        }
+      }
+      textDrawer.draw(vec(FIELD_SIZE.x / 2 - 160, -FIELD_SIZE.y / 2 + 35),
+                      "Players: ", from->ships.size());
+    } else {
+      textDrawer.draw({.pos = vec(-100, 0), .size = 24}, "Connecting...");
+    }
+
+    textDrawer.display(window);
+    window.display();
+  }
+  return 0;
+}
+
+// Simulated clients for load testing, all stepped from this thread
+int runBots(int count, int seconds, sf::IpAddress host, unsigned short port) {
+  // Bots ack every snapshot on loopback, so a short history is enough
+  std::vector<std::unique_ptr<Connection>> bots;
+  for (int i = 0; i < count; ++i) {
+    bots.push_back(std::make_unique<Connection>(host, port, 8));
+  }
+  print("Started ", count, " bots against ", host.toString(), ":", port);
+
+  std::default_random_engine engine;
+  std::uniform_int_distribution<int> steer(0, INPUT_LEFT | INPUT_RIGHT |
+                                                  INPUT_THRUST);
+  std::uniform_int_distribution<int> shoot(0, 29);
+  std::vector<uint8_t> actions(count);
+
+  auto tickDuration = std::chrono::nanoseconds(1'000'000'000 / TICK_RATE);
+  auto start = now();
+  auto nextTick = start;
+  auto statsStart = start;
+  long tick = 0;
+  while (now() - start < std::chrono::seconds(seconds)) {
+    for (int i = 0; i < count; ++i) {
+      // Hold a steering choice for a second at a time
+      if (tick % TICK_RATE == i % TICK_RATE) {
+        actions[i] = static_cast<uint8_t>(steer(engine));
+      }
+      bots[i]->receive();
+      bots[i]->send(actions[i] | (shoot(engine) == 0 ? INPUT_SHOOT : 0));
+    }
+
+    std::chrono::duration<double> statsElapsed = now() - statsStart;
+    if (statsElapsed.count() >= 1) {
+      std::size_t bytes = 0, decoded = 0, dropped = 0;
+      for (auto& bot : bots) {
+        bytes += bot->bytesReceived;
+        decoded += bot->snapshotsDecoded;
+        dropped += bot->snapshotsDropped;
+        bot->bytesReceived = bot->snapshotsDecoded = bot->snapshotsDropped = 0;
+      }
+      print("snapshots: ", decoded, "  dropped: ", dropped,
+            "  avg snapshot: ", decoded ? bytes / decoded : 0,
+            " B  per client: ", std::fixed, std::setprecision(1),
+            bytes * 8 / 1000.0 / statsElapsed.count() / count, " kbit/s");
+      statsStart = now();
+    }
+
+    ++tick;
+    nextTick += tickDuration;
+    std::this_thread::sleep_until(nextTick);
+  }
+
+  for (auto& bot : bots) {
+    bot->disconnect();
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  if (!args.empty() && args[0] == "--bots") {
+    int count = args.size() > 1 ? std::stoi(args[1]) : 100;
+    int seconds = args.size() > 2 ? std::stoi(args[2]) : 10;
+    sf::IpAddress host = args.size() > 3 ? args[3] : "127.0.0.1";
+    unsigned short port = args.size() > 4 ? std::stoi(args[4]) : DEFAULT_PORT;
+    return runBots(count, seconds, host, port);
+  }
+  sf::IpAddress host = args.size() > 0 ? args[0] : "127.0.0.1";
+  unsigned short port = args.size() > 1 ? std::stoi(args[1]) : DEFAULT_PORT;
+  return runClient(host, port);
+}
@@ -0,0 +1,739 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>  // Include this header for std::fixed and std::setprecision
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <utility>
+
+#include "polygon.hpp"
+#include "spawner.hpp"
+#include "util.hpp"
+
+const float shipAcceleration = 0.1f;
+constexpr float bulletVelocity = 5;
+constexpr float bulletRange = 1000;
+
+LayeredDrawer drawer(1);
+long frame = 0;
+
+struct Asteroid {
+  enum AsteroidSize { SMALL, MEDIUM, BIG };
+
+  static constexpr int NUM_POINTS = 8;
+
+  uint id;
+  sf::ConvexShape shape;
+  // Same points as shape, for collisions. Asteroids never rotate, so a point
+  // relative to the shape's position is already in the outline's space.
+  RadialPolygon<NUM_POINTS> outline;
+  sf::Vector2f velocity;
+  AsteroidSize size;
+
+  static inline int NEXT_ID = 0;
+  static inline int SMALL_RADIUS = 20;
+  static inline int MED_RADIUS = 50;
+  static inline int BIG_RADIUS = 100;
+
+  Asteroid(sf::Vector2f position, sf::Vector2f velocity, AsteroidSize size);
+
+  // Reinitializes as a new asteroid, reusing the shape's point storage
+  void reset(sf::Vector2f position, sf::Vector2f velocity, AsteroidSize size);
+
+  bool isPointInsideAsteroid(const sf::Vector2f& P, bool debug = true);
+
+  // Furthest a vertex of an asteroid of this size can be from its center
+  static float boundingRadius(AsteroidSize size);
+
+  void makeRandomAsteroid(sf::Vector2f position, AsteroidSize size);
+};
+
+struct Ship {
+  static inline const FixedPolygon<3> HULL = {{{{0, -10}, {7, 10}, {-7, 10}}}};
+
+  sf::ConvexShape shape;
+  sf::Vector2f velocity;
+
+  Ship();
+};
+
+struct Bullet {
+  static inline const FixedPolygon<4> SHAPE = {
+      {{{0, 0}, {2, 0}, {2, 4}, {0, 4}}}};
+
+  sf::ConvexShape shape;
+  sf::Vector2f velocity;
+  float range;
+
+  Bullet(sf::Vector2f pos, float rotation);
+
+  void reset(sf::Vector2f pos, float rotation);
+};
+
+bool isPointInsideConvexPolygon(const sf::ConvexShape& polygon,
+                                const sf::Vector2f& P);
+void applyVelocityToObject(sf::ConvexShape& shape, const sf::Vector2f& velocity,
+                           const sf::Vector2f& viewSize, bool log = true);
+std::vector<Asteroid> generateAsteroids(int count, float minX, float maxX,
+                                        float minY, float maxY);
+void generateAsteroids(Pool<Asteroid>& asteroids, int count, float minX,
+                       float maxX, float minY, float maxY);
+bool isPointInsideRadialPolygon(const sf::Vector2f& P,
+                                const sf::ConvexShape& poly,
+                                float magLimit = 200, bool debug = false);
+float normalizeAngle(float angle);
+
+template <typename... Args>
+void print_frame(Args&&... args) {
+  if (frame % 60 != 0) {
+    return;
+  }
+  print(args...);
+}
+
+// Moves the shape by the velocity and wraps it around the screen
+void applyVelocityToObject(sf::ConvexShape& shape, const sf::Vector2f& velocity,
+                           const sf::Vector2f& viewSize, bool log) {
+  shape.move(velocity);
+  if (shape.getPosition().x < -viewSize.x / 2) {
+    if (log) print("Wrapping X, pos: ", shape.getPosition());
+    shape.setPosition(viewSize.x / 2, shape.getPosition().y);
+    if (log) print("Wrapped  X, pos: ", shape.getPosition());
+  }
+  if (shape.getPosition().x > viewSize.x / 2) {
+    if (log) print("Wrapping X, pos: ", shape.getPosition());
+    shape.setPosition(-viewSize.x / 2, shape.getPosition().y);
+    if (log) print("Wrapped  X, pos: ", shape.getPosition());
+  }
+  if (shape.getPosition().y < -viewSize.y / 2) {
+    if (log) print("Wrapping Y, pos: ", shape.getPosition());
+    shape.setPosition(shape.getPosition().x, viewSize.y / 2);
+    if (log) print("Wrapped Y, pos: ", shape.getPosition());
+  }
+  if (shape.getPosition().y > viewSize.y / 2) {
+    if (log) print("Wrapping Y, pos: ", shape.getPosition());
+    shape.setPosition(shape.getPosition().x, -viewSize.y / 2);
+    if (log) print("Wrapped Y, pos: ", shape.getPosition());
+  }
+}
+
+// Places a wave of count big asteroids with spawner, whose buffers are reused
+// from wave to wave, and returns the spawner's points. Asteroids don't
+// overlap and none is within 200 units of the ship at the origin. Waves too
+// big for that (about 20 in a 1920x1080 view) get a smaller spacing, so they
+// overlap evenly a little instead of a few overlapping a lot. Any that still
+// don't fit go where they overlap the least, see WaveSpawner::overflow.
+const std::vector<WaveSpawner::Point>& spawnWave(WaveSpawner& spawner,
+                                                 int count, float minX,
+                                                 float maxX, float minY,
+                                                 float maxY, unsigned seed) {
+  spawner.min = {minX, minY};
+  spawner.max = {maxX, maxY};
+  for (auto size : {Asteroid::SMALL, Asteroid::MEDIUM, Asteroid::BIG}) {
+    spawner.spacing[size] = Asteroid::boundingRadius(size);
+  }
+  spawner.exclusionRadius = 200;
+  // A filled field holds FILL_DENSITY points per grid cell, which is half
+  // of twice the spacing squared. The exclusion zone counts as 1.5 times
+  // its area, since points next to it can't use all of their room either.
+  // Only depends on the count, so the biggest wave sizes the buffers for all
+  // others.
+  const float pi = 3.14159265f;
+  float area = (maxX - minX) * (maxY - minY) -
+               1.5f * pi * spawner.exclusionRadius * spawner.exclusionRadius;
+  float fitting = std::sqrt(2 * WaveSpawner::FILL_DENSITY *
+                            std::max(area, 1.f) / std::max(count, 1)) /
+                  2;
+  spawner.spacing[Asteroid::BIG] =
+      std::min(spawner.spacing[Asteroid::BIG], fitting);
+
+  std::array<int, WaveSpawner::MAX_KINDS> counts{};
+  counts[Asteroid::BIG] = count;
+  const auto& points = spawner.spawn(counts, seed);
+  if (points.size() < count) {
+    spawner.overflow(Asteroid::BIG, count - points.size(), seed);
+  }
+  return points;
+}
+
+// spawnWave with the spawner of the local game
+const std::vector<WaveSpawner::Point>& spawnWave(int count, float minX,
+                                                 float maxX, float minY,
+                                                 float maxY) {
+  static WaveSpawner spawner;
+  return spawnWave(spawner, count, minX, maxX, minY, maxY,
+                   static_cast<unsigned>(randomFloat(0, 1e9f)));
+}
+
+// Generates count number of asteroids with random positions and velocities
+std::vector<Asteroid> generateAsteroids(int count, float minX, float maxX,
+                                        float minY, float maxY) {
+  std::vector<Asteroid> asteroids;
+  for (const auto& point : spawnWave(count, minX, maxX, minY, maxY)) {
+    asteroids.emplace_back(point.position, randomVector2f(-1, 1, -1, 1),
+                           Asteroid::BIG);
+  }
+  return asteroids;
+}
+
+// Same as above, replacing the contents of a pool
+void generateAsteroids(Pool<Asteroid>& asteroids, int count, float minX,
+                       float maxX, float minY, float maxY) {
+  asteroids.clear();
+  for (const auto& point : spawnWave(count, minX, maxX, minY, maxY)) {
+    asteroids.add(point.position, randomVector2f(-1, 1, -1, 1), Asteroid::BIG);
+  }
+}
+
+// Function to normalize an angle to the range [0, 2 * pi)
+float normalizeAngle(float angle) {
+  std::fmod(angle, 2 * M_PI);
+  if (angle < 0) {
+    angle += 2 * M_PI;
+  }
+  return angle;
+}
+
+// Function to check if the point P is inside the regular radial polygon
+// Note: all vertices must have equal angles between them
+bool isPointInsideRadialPolygon(const sf::Vector2f& P,
+                                const sf::ConvexShape& poly, float magLimit,
+                                bool debug) {
+  if (poly.getPointCount() < 3) {
+    return false;
+  }
+  auto center = poly.getPosition();
+  auto Pc = P - center;  // vector from center of poly to point
+  float Pc_mag = magnitude(Pc);
+
+  if (Pc_mag > magLimit) {
+    return false;
+  }
+
+  if (debug) {
+    drawer.line(center, P);
+    drawer.point(P);
+  }
+
+  float Pc_angle = normalizeAngle(std::atan2(Pc.y, Pc.x));
+  float angleIncrement = 2 * M_PI / poly.getPointCount();
+  int preVertexInd = Pc_angle / angleIncrement;
+  int nextVertexInd = (preVertexInd + 1) % poly.getPointCount();
+  float t = (Pc_angle - angleIncrement * preVertexInd) / angleIncrement;
+  const auto& transform = poly.getTransform();
+  auto preV = transform.transformPoint(poly.getPoint(preVertexInd));
+  auto nextV = transform.transformPoint(poly.getPoint(nextVertexInd));
+  auto onCurve = lerp(preV, nextV, t) - center;
+  float r = magnitude(onCurve);
+
+  if (debug) {
+    drawer.line(center, center + onCurve);
+    drawer.point(center + onCurve);
+    drawer.point(preV);
+    drawer.point(nextV);
+  }
+
+  return Pc_mag < r;
+}
+
+// Function to check if the point P is inside the convex polygon
+// Note: not all polygons in ConvexShape are actually convex, but all are radial
+bool isPointInsideConvexPolygon(const sf::Vector2f& P,
+                                const sf::ConvexShape& polygon,
+                                float magLimit = 200) {
+  int n = polygon.getPointCount();
+  if (n < 3) return false;  // A polygon must have at least 3 vertices
+
+  if (magLimit > 0 && magnitude(P - polygon.getPosition()) > magLimit) {
+    return false;
+  }
+
+  auto& trans = polygon.getTransform();
+
+  sf::Vector2f prevVertex = trans.transformPoint(polygon.getPoint(n - 1));
+  sf::Vector2f firstVertex = trans.transformPoint(polygon.getPoint(0));
+  bool initialSign =
+      crossProduct(firstVertex - prevVertex, P - prevVertex) >= 0;
+
+  for (int i = 0; i < n; ++i) {
+    sf::Vector2f currentVertex = trans.transformPoint(polygon.getPoint(i));
+    sf::Vector2f nextVertex =
+        trans.transformPoint(polygon.getPoint((i + 1) % n));
+    if (crossProduct(nextVertex - currentVertex, P - currentVertex) >= 0 !=
+        initialSign) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**** Asteroid Impl ****/
+
+Asteroid::Asteroid(sf::Vector2f position, sf::Vector2f velocity,
+                   AsteroidSize size)
+    : id(NEXT_ID++), velocity(velocity), size(size) {
+  makeRandomAsteroid(position, size);
+}
+
+void Asteroid::reset(sf::Vector2f position, sf::Vector2f velocity,
+                     AsteroidSize size) {
+  this->id = NEXT_ID++;
+  this->velocity = velocity;
+  this->size = size;
+  makeRandomAsteroid(position, size);
+}
+
+bool Asteroid::isPointInsideAsteroid(const sf::Vector2f& P, bool debug) {
+  auto center = this->shape.getPosition();
+  auto local = P - center;
+  if (debug && magnitude(local) <= BIG_RADIUS * 2) {
+    std::size_t i = this->outline.sector(local);
+    drawer.line(center, P);
+    drawer.point(P);
+    drawer.point(center + this->outline.points[i]);
+    drawer.point(center + this->outline.points[(i + 1) % NUM_POINTS]);
+  }
+  return this->outline.contains(local);
+}
+
+float Asteroid::boundingRadius(AsteroidSize size) {
+  // makeRandomAsteroid jitters radii by up to a third
+  switch (size) {
+    case SMALL:
+      return SMALL_RADIUS * 4 / 3.f;
+    case MEDIUM:
+      return MED_RADIUS * 4 / 3.f;
+    case BIG:
+      break;
+  }
+  return BIG_RADIUS * 4 / 3.f;
+}
+
+// Lays out this->shape in place, so a reused asteroid doesn't reallocate it
+void Asteroid::makeRandomAsteroid(sf::Vector2f position, AsteroidSize size) {
+  auto& shape = this->shape;
+  float radius;
+  switch (size) {
+    case SMALL:
+      radius = 20;
+      break;
+    case MEDIUM:
+      radius = 50;
+      break;
+    case BIG:
+      radius = 100;
+      break;
+  }
+  std::array<float, NUM_POINTS> radii;
+  for (float& r : radii) {
+    r = radius + randomFloat(-radius / 3, radius / 3);
+  }
+  this->outline.setRadii(radii);
+  this->outline.applyTo(shape);
+
+  shape.setFillColor(sf::Color::Black);
+  shape.setOutlineColor(sf::Color::White);
+  shape.setOutlineThickness(1);
+  shape.setPosition(position);
+}
+
+std::ostream& operator<<(std::ostream& os, const Asteroid& asteroid) {
+  os << "Asteroid " << asteroid.id << " at " << asteroid.shape.getPosition()
+     << " with velocity " << asteroid.velocity;
+  return os;
+}
+
+/**** Ship Impl ****/
+
+Ship::Ship() : velocity(0, 0) {
+  HULL.applyTo(this->shape);
+  this->shape.setFillColor(sf::Color::Black);
+  this->shape.setOutlineColor(sf::Color::White);
+  this->shape.setOutlineThickness(1);
+}
+
+/**** Bullet Impl ****/
+
+Bullet::Bullet(sf::Vector2f pos, float rotation) {
+  SHAPE.applyTo(this->shape);
+  this->shape.setFillColor(sf::Color::White);
+  reset(pos, rotation);
+}
+
+void Bullet::reset(sf::Vector2f pos, float rotation) {
+  this->shape.setPosition(pos.x, pos.y);
+  this->shape.setRotation(rotation);
+  this->velocity = move_forward(rotation, bulletVelocity);
+  this->range = bulletRange;
+}
+
+/**** Entity Rendering ****/
+
+// Draws bullets, then asteroids, then the ship. Target is an sf::RenderWindow
+// or a CpuRasterizer for headless rendering, the entity lists are vectors or
+// Pools.
+template <typename Target, typename Asteroids, typename Bullets>
+void drawEntities(Target& target, const Ship& ship, const Asteroids& asteroids,
+                  const Bullets& bullets) {
+  for (const auto& bullet : bullets) {
+    target.draw(bullet.shape);
+  }
+  for (const auto& asteroid : asteroids) {
+    target.draw(asteroid.shape);
+  }
+  target.draw(ship.shape);
+}
+
+/**** Rules ****/
+
+// Shared by Game::update, the server and VecEnv, so the three play the same
+// game. Where they differ is listed at the top of server.cpp and vec_env.hpp.
+
+// Round size of a new game, every round adds ROUND_GROWTH big asteroids to
+// it, the first one included
+const int START_ASTEROIDS = 5;
+const int ROUND_GROWTH = 2;
+const int ROUND_DELAY = 100;  // Frames from clearing the field to the next
+
+// Whether the next round starts this frame: ROUND_DELAY frames after the
+// last asteroid is gone. newRoundFrame holds that frame while it waits, a
+// newRoundFrame of the current frame starts a round right away.
+bool roundStarts(std::size_t asteroidsLeft, long frame, int& newRoundFrame) {
+  if (asteroidsLeft > 0) {
+    return false;
+  }
+  if (newRoundFrame == frame) {
+    return true;
+  }
+  if (newRoundFrame < frame) {
+    newRoundFrame = frame + ROUND_DELAY;
+  }
+  return false;
+}
+
+// Points for shooting an asteroid
+uint asteroidScore(Asteroid::AsteroidSize size) {
+  switch (size) {
+    case Asteroid::BIG:
+      return 20;
+    case Asteroid::MEDIUM:
+      return 50;
+    case Asteroid::SMALL:
+      return 100;
+  }
+  return 0;
+}
+
+// Calls add(position, velocity, size) for each asteroid a shot one splits
+// into: two medium ones for a big one, two small ones for a medium one.
+// random(min, max) returns a vector with both components in [min, max], so
+// callers with their own generator get the same splits.
+template <typename Random, typename Add>
+void splitAsteroid(sf::Vector2f position, sf::Vector2f velocity,
+                   Asteroid::AsteroidSize size, Random&& random, Add&& add) {
+  if (size == Asteroid::SMALL) {
+    return;
+  }
+  for (int k = 1; k <= 2; ++k) {
+    // Big ones scatter their halves further apart
+    float spread = size == Asteroid::BIG ? 5.f : static_cast<float>(k);
+    sf::Vector2f offset = random(-spread, spread);
+    add(position + offset, velocity + random(-1.f, 1.f),
+        size == Asteroid::BIG ? Asteroid::MEDIUM : Asteroid::SMALL);
+  }
+}
+
+/**** Game ****/
+
+// Player input for one frame, read from the keyboard by main()
+struct Input {
+  bool thrust = false;
+  bool left = false;
+  bool right = false;
+  bool shoot = false;        // Space was pressed this frame
+  bool toggleDebug = false;  // Q was pressed this frame
+  bool restart = false;      // R is held
+  bool checkInside = false;  // E is held, debug check of the first asteroid
+};
+
+// State and per-frame logic of a single player game, driven by main() or
+// headless by alloc_bench. Everything that changes from frame to frame lives
+// in reused storage so that steady-state frames don't allocate.
+struct Game {
+  // An asteroid to spawn once this frame's removals are done
+  struct Split {
+    sf::Vector2f position;
+    sf::Vector2f velocity;
+    Asteroid::AsteroidSize size;
+  };
+
+  sf::Vector2f viewSize;
+  Ship ship;
+  Pool<Asteroid> asteroids;
+  Pool<Bullet> bullets;
+  uint score = 0;
+  std::vector<int> bulletsToRemove;
+  std::vector<int> asteroidsToRemove;
+  std::vector<Split> asteroidsToAdd;
+  sf::RectangleShape scoreRect;
+  sf::RectangleShape gameOverRect;
+
+  int newRoundFrame = 0;
+  int resetFrame = -1;
+  int numAsteroids = START_ASTEROIDS;
+  bool debug = false;
+
+  // Rounds reserve() sizes for by default, the pools only grow past it
+  static constexpr int RESERVED_ROUNDS = 30;
+
+  Game(sf::Vector2f viewSize);
+
+  // Sizes the pools, scratch vectors and drawers for the first rounds, so
+  // playing through them doesn't allocate once the first frames are done
+  void reserve(TextDrawer& textDrawer, int rounds = RESERVED_ROUNDS);
+
+  void update(const Input& input, TextDrawer& textDrawer);
+
+  template <typename Target>
+  void draw(Target& target, TextDrawer& textDrawer);
+};
+
+Game::Game(sf::Vector2f viewSize)
+    : viewSize(viewSize),
+      scoreRect(sf::Vector2f(200, 50)),
+      gameOverRect(sf::Vector2f(300, 110)) {
+  this->scoreRect.setPosition(-viewSize.x / 2 + 1 + 15,
+                              -viewSize.y / 2 + 1 + 15);
+  this->scoreRect.setFillColor(sf::Color::Black);
+  this->scoreRect.setOutlineColor(sf::Color(100, 100, 100));
+  this->scoreRect.setOutlineThickness(1);
+
+  this->gameOverRect.setPosition({-150, -40});
+  this->gameOverRect.setFillColor({30, 30, 35, 240});
+}
+
+void Game::reserve(TextDrawer& textDrawer, int rounds) {
+  // Every round adds ROUND_GROWTH asteroids, and each big one can become two
+  // medium and four small ones, so a round never holds more than four times
+  // its starting count
+  int maxWave = numAsteroids + ROUND_GROWTH * rounds;
+  int maxAsteroids = 4 * maxWave;
+  // At most one shot per frame, each living until it has flown its range
+  int maxBullets = static_cast<int>(bulletRange / bulletVelocity) + 1;
+
+  asteroids.reserve(maxAsteroids, vec(0, 0), vec(0, 0), Asteroid::SMALL);
+  bullets.reserve(maxBullets, vec(0, 0), 0.f);
+  // A bullet can be removed twice in a frame, and each hit splits into two
+  bulletsToRemove.reserve(2 * maxBullets);
+  asteroidsToRemove.reserve(maxBullets);
+  asteroidsToAdd.reserve(2 * maxBullets);
+
+  // An ID per asteroid in debug mode, plus the score, game over and the
+  // debug overlay lines
+  textDrawer.reserve(maxAsteroids + 16);
+  // The wave spawner's buffers, sized by the biggest wave
+  spawnWave(maxWave, -viewSize.x / 2, viewSize.x / 2, -viewSize.y / 2,
+            viewSize.y / 2);
+  // Collision lines and points of the debug mode
+  drawer.layers[0].vertices.reserve(1 << 16);
+  drawer.layers[0].batches.reserve(1 << 10);
+}
+
+void Game::update(const Input& input, TextDrawer& textDrawer) {
+  auto& ship = this->ship;
+  auto& asteroids = this->asteroids;
+  auto& bullets = this->bullets;
+
+  if (resetFrame == frame) {
+    newRoundFrame = frame;
+    score = 0;
+    numAsteroids = START_ASTEROIDS;
+    asteroids.clear();
+  }
+  if (resetFrame > frame) {
+    textDrawer.draw({.pos = vec(-100, -30), .size = 24}, "Game Over!");
+    textDrawer.draw({.pos = vec(-100, 0), .size = 24}, "Score: ", score);
+    textDrawer.draw({.pos = vec(-100, 30), .size = 24}, "Press R to restart");
+    if (input.restart) {
+      resetFrame = frame + 1;
+    }
+  } else if (roundStarts(asteroids.size(), frame, newRoundFrame)) {
+    numAsteroids += ROUND_GROWTH;
+    generateAsteroids(asteroids, numAsteroids, -viewSize.x / 2, viewSize.x / 2,
+                      -viewSize.y / 2, viewSize.y / 2);
+    bullets.clear();
+    ship.shape.setPosition(0, 0);
+    ship.velocity = {0, 0};
+  }
+
+  if (input.shoot) {
+    bullets.add(ship.shape.getPosition(), ship.shape.getRotation());
+  }
+  if (input.toggleDebug) {
+    debug = !debug;
+  }
+
+  // Update the ship's velocity based on input
+  if (input.thrust) {
+    ship.velocity += move_forward(ship.shape.getRotation(), shipAcceleration);
+  } else if (std::abs(ship.velocity.x) > 0 || std::abs(ship.velocity.y) > 0) {
+    // Decelerate ship smoothly to a standstill
+    if (std::abs(ship.velocity.x) > 0 || std::abs(ship.velocity.y) > 0) {
+      ship.velocity +=
+          normalize(ship.velocity) *
+          -std::min(shipAcceleration / 2, magnitude(ship.velocity));
+    }
+  }
+  if (input.left) {
+    ship.shape.rotate(-2);
+  }
+  if (input.right) {
+    ship.shape.rotate(2);
+  }
+  // Debugging key to check if the ship is inside an asteroid
+  if (input.checkInside && !asteroids.empty()) {
+    if (asteroids[0].isPointInsideAsteroid(ship.shape.getPosition()), true) {
+      textDrawer.draw(ship.shape.getPosition() + vec(20, 20), "Inside!");
+    } else {
+      textDrawer.draw(ship.shape.getPosition() + vec(20, 20), "Outside :(");
+    }
+  }
+
+  // Wrap Objects around the screen
+  for (auto& asteroid : asteroids) {
+    applyVelocityToObject(asteroid.shape, asteroid.velocity, viewSize);
+  }
+
+  applyVelocityToObject(ship.shape, ship.velocity, viewSize);
+
+  for (int i = 0; i < bullets.size(); ++i) {
+    auto& bullet = bullets[i];
+    applyVelocityToObject(bullet.shape, bullet.velocity, viewSize);
+
+    // Update bullet range
+    bullet.range -= magnitude(bullet.velocity);
+    if (bullet.range <= 0) {
+      bulletsToRemove.push_back(i);
+    }
+  }
+
+  // Detect collision between ship and asteroids
+  if (resetFrame < frame) {
+    bool shouldReset = false;
+    auto hull = Ship::HULL.transformed(ship.shape.getTransform());
+    for (int i = 0; i < asteroids.size(); ++i) {
+      auto& asteroid = asteroids[i];
+      for (const auto& pt : hull) {
+        if (asteroid.isPointInsideAsteroid(pt, debug)) {
+          shouldReset = true;
+          break;
+        }
+      }
+    }
+    // Reset the game if the ship is hit by an asteroid
+    if (shouldReset) {
+      print("Ship hit by asteroid!");
+      bullets.clear();
+      bulletsToRemove.clear();
+      resetFrame = frame + 300;
+    }
+  }
+
+  // Detect collisions between bullets and asteroids
+  for (int i = 0; i < bullets.size(); ++i) {
+    auto& bullet = bullets[i];
+
+    print_frame("Bullet Position: ", bullet.shape.getPosition());
+
+    for (int j = 0; j < asteroids.size(); ++j) {
+      auto& asteroid = asteroids[j];
+      print_frame("Checking Asteroid ", asteroid);
+
+      if (asteroid.isPointInsideAsteroid(bullet.shape.getPosition(), debug)) {
+        print("Hit!");
+        score += asteroidScore(asteroid.size);
+        splitAsteroid(
+            asteroid.shape.getPosition(), asteroid.velocity, asteroid.size,
+            [](float min, float max) {
+              return randomVector2f(min, max, min, max);
+            },
+            [this](sf::Vector2f position, sf::Vector2f velocity,
+                   Asteroid::AsteroidSize size) {
+              asteroidsToAdd.push_back({position, velocity, size});
+            });
+
+        // Mark the bullet and asteroid for removal
+        bulletsToRemove.push_back(i);
+        asteroidsToRemove.push_back(j);
+        break;
+      }
+    }
+  }
+
+  // A bullet can run out of range on the frame it hits, so indices may repeat
+  for (auto* indices : {&bulletsToRemove, &asteroidsToRemove}) {
+    std::sort(indices->begin(), indices->end());
+    indices->erase(std::unique(indices->begin(), indices->end()),
+                   indices->end());
+  }
+  bullets.remove(bulletsToRemove);
+  asteroids.remove(asteroidsToRemove);
+  for (const auto& split : asteroidsToAdd) {
+    asteroids.add(split.position, split.velocity, split.size);
+  }
+
+  // Clear the vectors of bullets and asteroids to remove
+  bulletsToRemove.clear();
+  asteroidsToRemove.clear();
+  asteroidsToAdd.clear();
+}
+
+// Draws the entities and score box and queues the text for this frame
+template <typename Target>
+void Game::draw(Target& target, TextDrawer& textDrawer) {
+  // Draw Bullets, Asteroids and Ship
+  drawEntities(target, ship, asteroids, bullets);
+
+  for (auto& asteroid : asteroids) {
+    print_frame(asteroid);
+
+    if (debug) {
+      textDrawer.draw(asteroid.shape.getPosition(), "ID: ", asteroid.id,
+                      " Pos: ", asteroid.shape.getPosition());
+    }
+  }
+  print_frame("");
+
+  // Draw score
+  target.draw(scoreRect);
+  textDrawer.draw(scoreRect.getPosition() + vec(75, 20), "Score: ", score);
+
+  if (resetFrame > frame) {
+    target.draw(gameOverRect);
+  }
+}
+
+/**** Misc Drawing Functions ****/
+
+// Only drawn, and not convex, so plain points rather than a FixedPolygon
+const std::array<sf::Vector2f, 6> ALIEN_SHIP = {
+    {{-20, -10}, {20, -10}, {10, 0}, {20, 10}, {-20, 10}, {-10, 0}}};
+
+sf::ConvexShape makeAlienShip() {
+  sf::ConvexShape alienShip;
+  alienShip.setPointCount(ALIEN_SHIP.size());
+  for (std::size_t i = 0; i < ALIEN_SHIP.size(); ++i) {
+    alienShip.setPoint(i, ALIEN_SHIP[i]);
+  }
+  alienShip.setFillColor(sf::Color::Black);
+  alienShip.setOutlineColor(sf::Color::White);
+  alienShip.setOutlineThickness(1);
+
+  return alienShip;
+}
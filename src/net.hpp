@@ -0,0 +1,527 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <SFML/Network.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "game.hpp"
+#include "util.hpp"
+
+/**** Protocol ****/
+
+// Client -> server, one per client frame:
+//   u8 INPUT | varint acked snapshot tick | u8 action bits
+// Client -> server when leaving:
+//   u8 DISCONNECT
+// Server -> client, every SNAPSHOT_INTERVAL ticks:
+//   u8 SNAPSHOT | varint player id | varint tick | varint base tick
+//   | ships | asteroids | bullets
+// where base tick 0 means "encoded against an empty world" and each entity
+// section is encoded by writeEntityDelta. A SNAPSHOT message longer than
+// MAX_PACKET_SIZE is sent as consecutive slices of it instead:
+//   u8 SNAPSHOT_PART | varint tick | varint part index | varint part count
+//   | PART_PAYLOAD bytes of the message (fewer in the last part)
+
+const unsigned short DEFAULT_PORT = 54000;
+const int TICK_RATE = 60;
+const int SNAPSHOT_INTERVAL = 2;  // ticks between snapshots, 30Hz
+const int SNAPSHOT_HISTORY = 64;  // snapshots kept for delta baselines
+const sf::Vector2f FIELD_SIZE = {1920, 1080};
+// Largest datagram sent, so IP never fragments it on a 1280 byte MTU (the
+// IPv6 minimum) after the IP and UDP headers
+const std::size_t MAX_PACKET_SIZE = 1200;
+
+enum MessageType : uint8_t { INPUT, DISCONNECT, SNAPSHOT, SNAPSHOT_PART };
+
+// Same bits as VecEnv::Action
+enum InputAction : uint8_t {
+  INPUT_THRUST = 1 << 0,
+  INPUT_LEFT = 1 << 1,
+  INPUT_RIGHT = 1 << 2,
+  INPUT_SHOOT = 1 << 3,
+};
+
+/**** Quantization ****/
+
+const float POSITION_SCALE = 16;  // 1/16 px
+
+inline int32_t quantizePosition(float v) {
+  return static_cast<int32_t>(std::lround(v * POSITION_SCALE));
+}
+inline float dequantizePosition(int32_t v) { return v / POSITION_SCALE; }
+
+// 256 steps per turn
+inline int32_t quantizeRotation(float degrees) {
+  return static_cast<int32_t>(std::lround(degrees / 360.f * 256)) & 0xff;
+}
+inline float dequantizeRotation(int32_t v) { return v * 360.f / 256; }
+
+const float VELOCITY_SCALE = 256;  // 1/256 px per tick
+
+inline int32_t quantizeVelocity(float v) {
+  return static_cast<int32_t>(std::lround(v * VELOCITY_SCALE));
+}
+inline float dequantizeVelocity(int32_t v) { return v / VELOCITY_SCALE; }
+
+/**** Snapshot State ****/
+
+// Entities are a sorted id plus a fixed number of quantized integer fields,
+// so deltas can be computed field by field without knowing the entity type
+template <int N>
+struct EntityState {
+  static constexpr int FIELD_COUNT = N;
+
+  uint32_t id;
+  std::array<int32_t, N> fields{};
+};
+
+enum ShipField {
+  SHIP_X,
+  SHIP_Y,
+  SHIP_ROTATION,
+  SHIP_ALIVE,
+  SHIP_SCORE,
+  SHIP_FIELDS
+};
+
+const int MAX_ASTEROID_POINTS = 16;
+enum AsteroidField {
+  ASTEROID_X,
+  ASTEROID_Y,
+  ASTEROID_SIZE,
+  ASTEROID_POINTS,
+  ASTEROID_RADIUS0,  // one radius per vertex, whole pixels
+  ASTEROID_FIELDS = ASTEROID_RADIUS0 + MAX_ASTEROID_POINTS
+};
+
+// Bullets fly in a straight line, so only their spawn state is sent and the
+// fields never change afterwards. Clients extrapolate with bulletPosition.
+enum BulletField {
+  BULLET_X,
+  BULLET_Y,
+  BULLET_VX,
+  BULLET_VY,
+  BULLET_TICK,  // tick of the spawn position
+  BULLET_FIELDS
+};
+
+using ShipState = EntityState<SHIP_FIELDS>;
+using AsteroidState = EntityState<ASTEROID_FIELDS>;
+using BulletState = EntityState<BULLET_FIELDS>;
+
+// Every vector is sorted by id
+struct Snapshot {
+  uint32_t tick = 0;
+  std::vector<ShipState> ships;
+  std::vector<AsteroidState> asteroids;
+  std::vector<BulletState> bullets;
+};
+
+// Ring of recent snapshots indexed by tick. Ticks are never 0, so a slot with
+// tick 0 is empty. A slot is only replaced by a newer tick, so a late packet
+// can't evict the snapshot the next delta is based on.
+struct SnapshotHistory {
+  std::vector<Snapshot> slots;
+
+  explicit SnapshotHistory(std::size_t capacity = SNAPSHOT_HISTORY)
+      : slots(capacity) {}
+
+  std::size_t slot(uint32_t tick) const {
+    return tick / SNAPSHOT_INTERVAL % slots.size();
+  }
+
+  void store(const Snapshot& snapshot) {
+    Snapshot& slot = this->slots[this->slot(snapshot.tick)];
+    if (snapshot.tick > slot.tick) {
+      slot = snapshot;
+    }
+  }
+
+  const Snapshot* find(uint32_t tick) const {
+    const Snapshot& slot = this->slots[this->slot(tick)];
+    return tick != 0 && slot.tick == tick ? &slot : nullptr;
+  }
+};
+
+/**** Byte Streams ****/
+
+struct ByteWriter {
+  std::vector<uint8_t> bytes;
+
+  void u8(uint8_t v) { this->bytes.push_back(v); }
+
+  // LEB128
+  void varint(uint32_t v) {
+    while (v >= 0x80) {
+      this->bytes.push_back(static_cast<uint8_t>(v | 0x80));
+      v >>= 7;
+    }
+    this->bytes.push_back(static_cast<uint8_t>(v));
+  }
+
+  // Zig-zag so small negative numbers stay small
+  void svarint(int32_t v) {
+    varint((static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31));
+  }
+};
+
+// Reads past the end set ok to false and return 0
+struct ByteReader {
+  const uint8_t* data;
+  std::size_t size;
+  std::size_t pos = 0;
+  bool ok = true;
+
+  ByteReader(const uint8_t* data, std::size_t size) : data(data), size(size) {}
+
+  uint8_t u8() {
+    if (pos >= size) {
+      ok = false;
+      return 0;
+    }
+    return data[pos++];
+  }
+
+  uint32_t varint() {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+      uint8_t b = u8();
+      v |= static_cast<uint32_t>(b & 0x7f) << shift;
+      if (!(b & 0x80)) {
+        return v;
+      }
+    }
+    ok = false;
+    return 0;
+  }
+
+  int32_t svarint() {
+    uint32_t v = varint();
+    return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+  }
+};
+
+/**** Delta Encoding ****/
+
+// Writes the difference between two id-sorted entity lists:
+//   varint removed count, removed ids (each as the gap from the previous id)
+//   varint changed count, then per changed entity: id gap, varint mask of
+//   changed fields, and a zig-zag varint difference for each changed field.
+// Entities missing from base are diffed against all zero fields, and
+// entities identical to base are not written at all.
+template <typename State>
+void writeEntityDelta(ByteWriter& out, const std::vector<State>& base,
+                      const std::vector<State>& current) {
+  static_assert(State::FIELD_COUNT <= 32);
+  static const State zero{};
+
+  std::vector<uint32_t> removed;
+  std::vector<std::pair<const State*, const State*>> changed;
+  std::size_t i = 0, j = 0;
+  while (i < base.size() || j < current.size()) {
+    if (j == current.size() ||
+        (i < base.size() && base[i].id < current[j].id)) {
+      removed.push_back(base[i++].id);
+    } else if (i == base.size() || current[j].id < base[i].id) {
+      changed.push_back({&zero, &current[j++]});
+    } else {
+      if (base[i].fields != current[j].fields) {
+        changed.push_back({&base[i], &current[j]});
+      }
+      ++i, ++j;
+    }
+  }
+
+  out.varint(static_cast<uint32_t>(removed.size()));
+  uint32_t prevId = 0;
+  for (uint32_t id : removed) {
+    out.varint(id - prevId);
+    prevId = id;
+  }
+
+  out.varint(static_cast<uint32_t>(changed.size()));
+  prevId = 0;
+  for (auto [from, to] : changed) {
+    out.varint(to->id - prevId);
+    prevId = to->id;
+    uint32_t mask = 0;
+    for (int f = 0; f < State::FIELD_COUNT; ++f) {
+      if (from->fields[f] != to->fields[f]) {
+        mask |= 1u << f;
+      }
+    }
+    out.varint(mask);
+    for (int f = 0; f < State::FIELD_COUNT; ++f) {
+      if (mask & (1u << f)) {
+        out.svarint(to->fields[f] - from->fields[f]);
+      }
+    }
+  }
+}
+
+// Inverse of writeEntityDelta, returns false on malformed input
+template <typename State>
+bool readEntityDelta(ByteReader& in, const std::vector<State>& base,
+                     std::vector<State>& current) {
+  current = base;
+
+  uint32_t removedCount = in.varint();
+  uint32_t id = 0;
+  for (uint32_t k = 0; k < removedCount && in.ok; ++k) {
+    id += in.varint();
+    auto it = std::lower_bound(
+        current.begin(), current.end(), id,
+        [](const State& s, uint32_t id) { return s.id < id; });
+    if (it == current.end() || it->id != id) {
+      return false;
+    }
+    current.erase(it);
+  }
+
+  uint32_t changedCount = in.varint();
+  std::size_t oldSize = current.size();
+  id = 0;
+  for (uint32_t k = 0; k < changedCount && in.ok; ++k) {
+    id += in.varint();
+    auto end = current.begin() + oldSize;
+    auto it = std::lower_bound(
+        current.begin(), end, id,
+        [](const State& s, uint32_t id) { return s.id < id; });
+    State* state;
+    if (it != end && it->id == id) {
+      state = &*it;
+    } else {
+      current.push_back({id});
+      state = &current.back();
+    }
+    uint32_t mask = in.varint();
+    for (int f = 0; f < State::FIELD_COUNT; ++f) {
+      if (mask & (1u << f)) {
+        state->fields[f] += in.svarint();
+      }
+    }
+  }
+  if (current.size() != oldSize) {
+    std::sort(current.begin(), current.end(),
+              [](const State& a, const State& b) { return a.id < b.id; });
+  }
+  return in.ok;
+}
+
+inline void writeSnapshot(ByteWriter& out, uint32_t playerId,
+                          const Snapshot* base, const Snapshot& snapshot) {
+  static const Snapshot empty;
+  if (!base) {
+    base = &empty;
+  }
+  out.u8(SNAPSHOT);
+  out.varint(playerId);
+  out.varint(snapshot.tick);
+  out.varint(base->tick);
+  writeEntityDelta(out, base->ships, snapshot.ships);
+  writeEntityDelta(out, base->asteroids, snapshot.asteroids);
+  writeEntityDelta(out, base->bullets, snapshot.bullets);
+}
+
+// Reads a snapshot after the message type byte. Returns false if the packet
+// is malformed or its base tick is no longer in history.
+inline bool readSnapshot(ByteReader& in, const SnapshotHistory& history,
+                         uint32_t& playerId, Snapshot& snapshot) {
+  static const Snapshot empty;
+  playerId = in.varint();
+  snapshot.tick = in.varint();
+  uint32_t baseTick = in.varint();
+  const Snapshot* base = baseTick == 0 ? &empty : history.find(baseTick);
+  if (!in.ok || !base) {
+    return false;
+  }
+  return readEntityDelta(in, base->ships, snapshot.ships) &&
+         readEntityDelta(in, base->asteroids, snapshot.asteroids) &&
+         readEntityDelta(in, base->bullets, snapshot.bullets);
+}
+
+/**** Snapshot Parts ****/
+
+// A part header is at most a type byte and three 5 byte varints
+const std::size_t PART_PAYLOAD = MAX_PACKET_SIZE - 16;
+const uint32_t MAX_SNAPSHOT_PARTS = 128;  // about 150 KB
+
+inline uint32_t snapshotPartCount(std::size_t messageSize) {
+  return static_cast<uint32_t>((messageSize + PART_PAYLOAD - 1) /
+                               PART_PAYLOAD);
+}
+
+inline void writeSnapshotPart(ByteWriter& out,
+                              const std::vector<uint8_t>& message,
+                              uint32_t tick, uint32_t part) {
+  std::size_t begin = part * PART_PAYLOAD;
+  std::size_t end = std::min(message.size(), begin + PART_PAYLOAD);
+  out.u8(SNAPSHOT_PART);
+  out.varint(tick);
+  out.varint(part);
+  out.varint(snapshotPartCount(message.size()));
+  out.bytes.insert(out.bytes.end(), message.begin() + begin,
+                   message.begin() + end);
+}
+
+// Collects SNAPSHOT_PART datagrams until a whole SNAPSHOT message is there.
+// Parts may arrive in any order. Like in SnapshotHistory a slot only gives
+// way to a newer tick, so a late part can't discard a newer message.
+struct SnapshotAssembler {
+  struct Message {
+    uint32_t tick = 0;
+    uint32_t count = 0;
+    uint32_t received = 0;
+    std::size_t size = 0;
+    std::vector<bool> have;
+    std::vector<uint8_t> bytes;
+  };
+  std::vector<Message> slots;
+
+  explicit SnapshotAssembler(std::size_t capacity = 4) : slots(capacity) {}
+
+  // Adds a part read after the message type byte. Returns the whole message
+  // once its last missing part arrives, null before that and for malformed
+  // or stale parts.
+  const std::vector<uint8_t>* add(ByteReader& in) {
+    uint32_t tick = in.varint();
+    uint32_t part = in.varint();
+    uint32_t count = in.varint();
+    std::size_t length = in.size - std::min(in.pos, in.size);
+    if (!in.ok || tick == 0 || count == 0 || count > MAX_SNAPSHOT_PARTS ||
+        part >= count || length > PART_PAYLOAD ||
+        (part + 1 < count && length != PART_PAYLOAD)) {
+      return nullptr;
+    }
+
+    Message& message = slots[tick / SNAPSHOT_INTERVAL % slots.size()];
+    if (tick < message.tick) {
+      return nullptr;
+    }
+    if (tick > message.tick) {
+      message.tick = tick;
+      message.count = count;
+      message.received = 0;
+      message.have.assign(count, false);
+      message.bytes.resize(count * PART_PAYLOAD);
+    }
+    if (count != message.count || message.have[part]) {
+      return nullptr;
+    }
+    message.have[part] = true;
+    ++message.received;
+    std::copy(in.data + in.pos, in.data + in.size,
+              message.bytes.begin() + part * PART_PAYLOAD);
+    if (part + 1 == count) {
+      message.size = part * PART_PAYLOAD + length;
+    }
+    if (message.received < count) {
+      return nullptr;
+    }
+    message.bytes.resize(message.size);
+    return &message.bytes;
+  }
+};
+
+/**** Conversions ****/
+
+inline AsteroidState makeAsteroidState(const Asteroid& asteroid) {
+  AsteroidState state{asteroid.id};
+  const sf::ConvexShape& shape = asteroid.shape;
+  int points = std::min<int>(shape.getPointCount(), MAX_ASTEROID_POINTS);
+  state.fields[ASTEROID_X] = quantizePosition(shape.getPosition().x);
+  state.fields[ASTEROID_Y] = quantizePosition(shape.getPosition().y);
+  state.fields[ASTEROID_SIZE] = asteroid.size;
+  state.fields[ASTEROID_POINTS] = points;
+  for (int i = 0; i < points; ++i) {
+    state.fields[ASTEROID_RADIUS0 + i] =
+        static_cast<int32_t>(std::lround(magnitude(shape.getPoint(i))));
+  }
+  return state;
+}
+
+// Rebuilds the polygon the same way makeRandomAsteroid lays it out
+inline sf::ConvexShape makeAsteroidShape(const AsteroidState& state) {
+  sf::ConvexShape shape;
+  int points =
+      std::clamp(state.fields[ASTEROID_POINTS], 0, MAX_ASTEROID_POINTS);
+  const float pi = 3.14159265358979323846f;
+  float angleIncrement = points > 0 ? 2 * pi / points : 0;
+  shape.setPointCount(points);
+  for (int i = 0; i < points; ++i) {
+    float r = static_cast<float>(state.fields[ASTEROID_RADIUS0 + i]);
+    shape.setPoint(i, {r * std::cos(i * angleIncrement),
+                       r * std::sin(i * angleIncrement)});
+  }
+  shape.setFillColor(sf::Color::Black);
+  shape.setOutlineColor(sf::Color::White);
+  shape.setOutlineThickness(1);
+  return shape;
+}
+
+inline BulletState makeBulletState(uint32_t id, const Bullet& bullet,
+                                   uint32_t tick) {
+  BulletState state{id};
+  state.fields[BULLET_X] = quantizePosition(bullet.shape.getPosition().x);
+  state.fields[BULLET_Y] = quantizePosition(bullet.shape.getPosition().y);
+  state.fields[BULLET_VX] = quantizeVelocity(bullet.velocity.x);
+  state.fields[BULLET_VY] = quantizeVelocity(bullet.velocity.y);
+  state.fields[BULLET_TICK] = static_cast<int32_t>(tick);
+  return state;
+}
+
+/**** Interpolation ****/
+
+// One axis of an object moved by velocity for ticks whole ticks, wrapped like
+// applyVelocityToObject: past an edge it is put on the opposite edge and the
+// overshoot is dropped. From there every wrap takes the same number of ticks.
+inline float wrappedAxis(float start, float velocity, int ticks, float half) {
+  if (velocity == 0 || ticks <= 0) {
+    return start + velocity * ticks;
+  }
+  float speed = std::abs(velocity);
+  float edge = velocity > 0 ? half : -half;
+  // Ticks until it first goes past the edge
+  int first = static_cast<int>(std::floor(std::abs(edge - start) / speed)) + 1;
+  if (ticks < first) {
+    return start + velocity * ticks;
+  }
+  int period = static_cast<int>(std::floor(2 * half / speed)) + 1;
+  return -edge + velocity * ((ticks - first) % period);
+}
+
+// Position of a bullet at a (fractional) tick, following the server's
+// applyVelocityToObject steps and moving linearly within a tick
+inline sf::Vector2f bulletPosition(const BulletState& state, float tick) {
+  float elapsed = tick - state.fields[BULLET_TICK];
+  int ticks = static_cast<int>(std::floor(elapsed));
+  float fraction = elapsed - ticks;
+  sf::Vector2f velocity = {dequantizeVelocity(state.fields[BULLET_VX]),
+                           dequantizeVelocity(state.fields[BULLET_VY])};
+  return {wrappedAxis(dequantizePosition(state.fields[BULLET_X]), velocity.x,
+                      ticks, FIELD_SIZE.x / 2) +
+              velocity.x * fraction,
+          wrappedAxis(dequantizePosition(state.fields[BULLET_Y]), velocity.y,
+                      ticks, FIELD_SIZE.y / 2) +
+              velocity.y * fraction};
+}
+
+// Interpolates one quantized position component, snapping instead of
+// sweeping across the screen when the entity wrapped between snapshots
+inline float interpolatePosition(int32_t a, int32_t b, float t,
+                                 float fieldSize) {
+  float from = dequantizePosition(a), to = dequantizePosition(b);
+  if (std::abs(to - from) > fieldSize / 2) {
+    return t < 0.5f ? from : to;
+  }
+  return from + (to - from) * t;
+}
+
+inline float interpolateRotation(int32_t a, int32_t b, float t) {
+  int32_t diff = ((b - a + 128) & 0xff) - 128;  // shortest way around
+  return dequantizeRotation(a) + diff * t * 360.f / 256;
+}
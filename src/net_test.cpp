@@ -0,0 +1,329 @@
+// Tests for the snapshot protocol in net.hpp: delta encoding round trips,
+// SnapshotHistory eviction, snapshot parts and the wrapped bullet motion
+// clients extrapolate. Prints each failed check and exits with 1 if any.
+//
+// Usage: net_test
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "game.hpp"
+#include "net.hpp"
+#include "util.hpp"
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+  if (!ok) {
+    print("FAILED: ", what);
+    ++failures;
+  }
+}
+
+template <typename State>
+bool sameStates(const std::vector<State>& a, const std::vector<State>& b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                    [](const State& x, const State& y) {
+                      return x.id == y.id && x.fields == y.fields;
+                    });
+}
+
+bool sameSnapshots(const Snapshot& a, const Snapshot& b) {
+  return a.tick == b.tick && sameStates(a.ships, b.ships) &&
+         sameStates(a.asteroids, b.asteroids) &&
+         sameStates(a.bullets, b.bullets);
+}
+
+// Sorted states with random fields, keeping each id with probability keep
+template <typename State>
+std::vector<State> randomStates(std::minstd_rand& rng, uint32_t maxId,
+                                float keep) {
+  std::uniform_real_distribution<float> chance(0, 1);
+  std::uniform_int_distribution<int32_t> field(-100000, 100000);
+  std::vector<State> states;
+  for (uint32_t id = 1; id <= maxId; ++id) {
+    if (chance(rng) < keep) {
+      State state{id};
+      for (auto& f : state.fields) {
+        f = field(rng);
+      }
+      states.push_back(state);
+    }
+  }
+  return states;
+}
+
+// Current is base with some entities removed, some added and some changed
+template <typename State>
+std::vector<State> mutateStates(std::minstd_rand& rng,
+                                const std::vector<State>& base,
+                                uint32_t maxId) {
+  std::uniform_real_distribution<float> chance(0, 1);
+  std::uniform_int_distribution<int32_t> step(-300, 300);
+  std::vector<State> current;
+  for (State state : base) {
+    if (chance(rng) < 0.1f) {
+      continue;
+    }
+    for (auto& f : state.fields) {
+      if (chance(rng) < 0.3f) {
+        f += step(rng);
+      }
+    }
+    current.push_back(state);
+  }
+  for (State state : randomStates<State>(rng, maxId, 0.05f)) {
+    auto it = std::lower_bound(
+        current.begin(), current.end(), state.id,
+        [](const State& s, uint32_t id) { return s.id < id; });
+    if (it == current.end() || it->id != state.id) {
+      current.insert(it, state);
+    }
+  }
+  return current;
+}
+
+template <typename State>
+bool roundTrips(const std::vector<State>& base,
+                const std::vector<State>& current) {
+  ByteWriter out;
+  writeEntityDelta(out, base, current);
+  ByteReader in(out.bytes.data(), out.bytes.size());
+  std::vector<State> decoded;
+  return readEntityDelta(in, base, decoded) && in.pos == in.size &&
+         sameStates(decoded, current);
+}
+
+void testEntityDelta() {
+  std::minstd_rand rng(1);
+  for (int i = 0; i < 200; ++i) {
+    auto ships = randomStates<ShipState>(rng, 40, 0.5f);
+    auto asteroids = randomStates<AsteroidState>(rng, 400, 0.5f);
+    check(roundTrips(ships, mutateStates(rng, ships, 60)),
+          "ship delta round trip");
+    check(roundTrips(asteroids, mutateStates(rng, asteroids, 600)),
+          "asteroid delta round trip");
+    check(roundTrips({}, asteroids), "delta against an empty base");
+    check(roundTrips(asteroids, {}), "delta removing everything");
+  }
+
+  auto ships = randomStates<ShipState>(rng, 40, 0.5f);
+  ByteWriter out;
+  writeEntityDelta(out, ships, ships);
+  check(out.bytes.size() == 2, "unchanged states write two zero counts");
+
+  // Every truncation of a delta is rejected instead of read past the end
+  auto current = mutateStates(rng, ships, 60);
+  out.bytes.clear();
+  writeEntityDelta(out, ships, current);
+  bool truncatedRejected = true;
+  for (std::size_t size = 0; size < out.bytes.size(); ++size) {
+    ByteReader in(out.bytes.data(), size);
+    std::vector<ShipState> decoded;
+    truncatedRejected &= !readEntityDelta(in, ships, decoded);
+  }
+  check(truncatedRejected, "truncated delta rejected");
+
+  // Removing an id the base doesn't have is malformed
+  out.bytes.clear();
+  out.varint(1);
+  out.varint(1000);
+  out.varint(0);
+  ByteReader in(out.bytes.data(), out.bytes.size());
+  std::vector<ShipState> decoded;
+  check(!readEntityDelta(in, ships, decoded), "unknown removed id rejected");
+}
+
+Snapshot randomSnapshot(std::minstd_rand& rng, uint32_t tick, int asteroids) {
+  Snapshot snapshot;
+  snapshot.tick = tick;
+  snapshot.ships = randomStates<ShipState>(rng, 8, 0.5f);
+  snapshot.asteroids = randomStates<AsteroidState>(rng, asteroids, 0.8f);
+  snapshot.bullets = randomStates<BulletState>(rng, 100, 0.3f);
+  return snapshot;
+}
+
+void testSnapshot() {
+  std::minstd_rand rng(2);
+  SnapshotHistory history;
+  Snapshot base = randomSnapshot(rng, 10, 50);
+  history.store(base);
+  Snapshot current = base;
+  current.tick = 12;
+  current.asteroids = mutateStates(rng, base.asteroids, 80);
+
+  ByteWriter out;
+  writeSnapshot(out, 7, &base, current);
+  ByteReader in(out.bytes.data(), out.bytes.size());
+  uint32_t playerId = 0;
+  Snapshot decoded;
+  check(in.u8() == SNAPSHOT && readSnapshot(in, history, playerId, decoded) &&
+            playerId == 7 && sameSnapshots(decoded, current),
+        "snapshot round trip");
+
+  SnapshotHistory empty;
+  ByteReader missing(out.bytes.data(), out.bytes.size());
+  missing.u8();
+  check(!readSnapshot(missing, empty, playerId, decoded),
+        "snapshot with a missing base rejected");
+}
+
+void testHistory() {
+  SnapshotHistory history(4);
+  auto at = [](uint32_t tick) {
+    Snapshot snapshot;
+    snapshot.tick = tick;
+    snapshot.ships.push_back({tick});
+    return snapshot;
+  };
+  // Ticks 2 and 10 share a slot in a history of 4
+  uint32_t older = 2, newer = 2 + 4 * SNAPSHOT_INTERVAL;
+  check(history.slot(older) == history.slot(newer), "ticks share a slot");
+  check(!history.find(0) && !history.find(older), "empty history");
+
+  history.store(at(older));
+  check(history.find(older) && history.find(older)->ships[0].id == older,
+        "stored snapshot found");
+  history.store(at(newer));
+  check(!history.find(older), "newer tick evicts the older one");
+  check(history.find(newer) && history.find(newer)->ships[0].id == newer,
+        "newer tick found");
+  history.store(at(older));
+  check(!history.find(older) && history.find(newer),
+        "late older tick doesn't evict the newer one");
+}
+
+// Sends the message as parts in the given order through an assembler and
+// returns how many times it came out whole and unchanged
+int reassemble(SnapshotAssembler& assembler,
+               const std::vector<uint8_t>& message, uint32_t tick,
+               const std::vector<uint32_t>& order) {
+  int completed = 0;
+  for (uint32_t part : order) {
+    ByteWriter out;
+    writeSnapshotPart(out, message, tick, part);
+    check(out.bytes.size() <= MAX_PACKET_SIZE, "part fits a packet");
+    ByteReader in(out.bytes.data(), out.bytes.size());
+    check(in.u8() == SNAPSHOT_PART, "part type");
+    const std::vector<uint8_t>* whole = assembler.add(in);
+    if (whole) {
+      check(*whole == message, "reassembled message matches");
+      ++completed;
+    }
+  }
+  return completed;
+}
+
+void testParts() {
+  std::minstd_rand rng(3);
+  Snapshot snapshot = randomSnapshot(rng, 20, 2000);
+  ByteWriter out;
+  writeSnapshot(out, 3, nullptr, snapshot);
+  uint32_t count = snapshotPartCount(out.bytes.size());
+  check(count > 1 && count <= MAX_SNAPSHOT_PARTS, "full snapshot needs parts");
+
+  std::vector<uint32_t> order(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), rng);
+  std::vector<uint32_t> duplicated = order;
+  duplicated.push_back(order[0]);
+  duplicated.insert(duplicated.begin() + count / 2, order[1]);
+
+  SnapshotAssembler assembler;
+  check(reassemble(assembler, out.bytes, 20, duplicated) == 1,
+        "shuffled parts with duplicates complete once");
+
+  // The reassembled message decodes like a single datagram would
+  SnapshotAssembler decoder;
+  const std::vector<uint8_t>* whole = nullptr;
+  for (uint32_t part : order) {
+    ByteWriter partOut;
+    writeSnapshotPart(partOut, out.bytes, 20, part);
+    ByteReader in(partOut.bytes.data(), partOut.bytes.size());
+    in.u8();
+    whole = decoder.add(in);
+  }
+  SnapshotHistory history;
+  uint32_t playerId = 0;
+  Snapshot decoded;
+  bool ok = whole != nullptr;
+  if (ok) {
+    ByteReader in(whole->data(), whole->size());
+    ok = in.u8() == SNAPSHOT &&
+         readSnapshot(in, history, playerId, decoded) && playerId == 3 &&
+         sameSnapshots(decoded, snapshot);
+  }
+  check(ok, "reassembled snapshot decodes");
+
+  // A message missing a part never completes, and once a newer tick took
+  // its slot the late part is ignored
+  SnapshotAssembler lossy(1);
+  std::vector<uint32_t> missingOne(order.begin() + 1, order.end());
+  check(reassemble(lossy, out.bytes, 20, missingOne) == 0,
+        "message missing a part stays incomplete");
+  std::vector<uint8_t> small(PART_PAYLOAD + 1, 42);
+  check(reassemble(lossy, small, 22, {1, 0}) == 1, "newer tick replaces");
+  check(reassemble(lossy, out.bytes, 20, {order[0]}) == 0,
+        "late part of an older tick ignored");
+
+  // Malformed parts are rejected
+  ByteWriter bad;
+  bad.u8(SNAPSHOT_PART);
+  bad.varint(30);
+  bad.varint(0);
+  bad.varint(2);
+  bad.bytes.push_back(1);  // short but not the last part
+  ByteReader in(bad.bytes.data(), bad.bytes.size());
+  in.u8();
+  SnapshotAssembler strict;
+  check(!strict.add(in), "short middle part rejected");
+}
+
+// wrappedAxis must land where applyVelocityToObject steps the server's
+// bullets, wraps included
+void testWrappedAxis() {
+  std::minstd_rand rng(4);
+  std::uniform_real_distribution<float> angle(0, 360);
+  std::uniform_real_distribution<float> x(-FIELD_SIZE.x / 2, FIELD_SIZE.x / 2);
+  std::uniform_real_distribution<float> y(-FIELD_SIZE.y / 2, FIELD_SIZE.y / 2);
+  float worst = 0;
+  for (int i = 0; i < 100; ++i) {
+    Bullet bullet({x(rng), y(rng)}, angle(rng));
+    BulletState state = makeBulletState(1, bullet, 0);
+    // Start from the quantized state, as a client does
+    sf::ConvexShape shape;
+    shape.setPosition(dequantizePosition(state.fields[BULLET_X]),
+                      dequantizePosition(state.fields[BULLET_Y]));
+    sf::Vector2f velocity = {dequantizeVelocity(state.fields[BULLET_VX]),
+                             dequantizeVelocity(state.fields[BULLET_VY])};
+    for (int tick = 1; tick <= 2000; ++tick) {
+      applyVelocityToObject(shape, velocity, FIELD_SIZE, false);
+      sf::Vector2f d = bulletPosition(state, tick) - shape.getPosition();
+      worst = std::max(worst, std::max(std::abs(d.x), std::abs(d.y)));
+    }
+  }
+  check(worst < 0.5f, "wrappedAxis follows applyVelocityToObject");
+
+  check(wrappedAxis(10, 0, 100, 960) == 10, "still object stays");
+  check(wrappedAxis(955, 5, 1, 960) == 960, "reaching the edge doesn't wrap");
+  check(wrappedAxis(958, 5, 1, 960) == -960, "past the edge wraps");
+  check(wrappedAxis(-958, -5, 2, 960) == 955, "negative velocity wraps");
+}
+
+int main() {
+  testEntityDelta();
+  testSnapshot();
+  testHistory();
+  testParts();
+  testWrappedAxis();
+  if (failures) {
+    print(failures, " checks failed");
+    return 1;
+  }
+  print("All checks passed");
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+// Polygons with a vertex count fixed at compile time. The per-vertex loops
+// are expanded with index sequences, so there is no runtime count, no modulo
+// indexing and no call per point into sf::Transform.
+//
+// FixedPolygon<N> is a convex polygon in local space, used for the ship and
+// bullets. RadialPolygon<N> is a polygon with one vertex every 360 / N
+// degrees around its origin, the layout of an asteroid.
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// std::sin and std::cos only become constexpr in C++26. Taylor series around
+// 0, for angles reduced to [-pi, pi].
+constexpr double constexprSin(double x) {
+  const double pi = 3.14159265358979323846;
+  while (x > pi) x -= 2 * pi;
+  while (x < -pi) x += 2 * pi;
+  double term = x, sum = x;
+  for (int i = 1; i < 20; ++i) {
+    term *= -x * x / ((2 * i) * (2 * i + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+constexpr double constexprCos(double x) {
+  return constexprSin(x + 3.14159265358979323846 / 2);
+}
+
+// Point transformed by the 4x4 matrix of an sf::Transform, like
+// sf::Transform::transformPoint but inlined
+inline sf::Vector2f transformPoint(const float* m, const sf::Vector2f& p) {
+  return {m[0] * p.x + m[4] * p.y + m[12], m[1] * p.x + m[5] * p.y + m[13]};
+}
+
+template <std::size_t N>
+struct FixedPolygon {
+  static_assert(N >= 3, "a polygon needs at least 3 vertices");
+
+  std::array<sf::Vector2f, N> points;
+
+  // Sets a ConvexShape's points to this polygon
+  void applyTo(sf::ConvexShape& shape) const {
+    shape.setPointCount(N);
+    for (std::size_t i = 0; i < N; ++i) {
+      shape.setPoint(i, this->points[i]);
+    }
+  }
+
+  std::array<sf::Vector2f, N> transformed(const sf::Transform& t) const {
+    return transformed(t.getMatrix(), std::make_index_sequence<N>{});
+  }
+
+  // Whether world space point P is inside the polygon placed by t. Works for
+  // either winding order.
+  bool contains(const sf::Vector2f& P, const sf::Transform& t) const {
+    return contains(P, transformed(t), std::make_index_sequence<N>{});
+  }
+
+ private:
+  template <std::size_t... I>
+  std::array<sf::Vector2f, N> transformed(const float* m,
+                                          std::index_sequence<I...>) const {
+    return {transformPoint(m, this->points[I])...};
+  }
+
+  template <std::size_t... I>
+  static bool contains(const sf::Vector2f& P,
+                       const std::array<sf::Vector2f, N>& v,
+                       std::index_sequence<I...>) {
+    auto side = [&](const sf::Vector2f& a, const sf::Vector2f& b) {
+      return (b.x - a.x) * (P.y - a.y) - (b.y - a.y) * (P.x - a.x);
+    };
+    const float sides[N] = {side(v[I], v[(I + 1) % N])...};
+    // & rather than && so the folds don't turn into a branch per edge
+    return ((sides[I] >= 0) & ...) | ((sides[I] <= 0) & ...);
+  }
+};
+
+template <std::size_t N>
+struct RadialPolygon {
+  static_assert(N >= 3, "a polygon needs at least 3 vertices");
+  static_assert(N <= 31, "sector() keeps one bit per vertex");
+
+  // Unit vector towards vertex i, at angle i * 2 * pi / N
+  static constexpr auto COS = [] {
+    std::array<float, N> table{};
+    for (std::size_t i = 0; i < N; ++i) {
+      table[i] = static_cast<float>(
+          constexprCos(i * 2 * 3.14159265358979323846 / N));
+    }
+    return table;
+  }();
+  static constexpr auto SIN = [] {
+    std::array<float, N> table{};
+    for (std::size_t i = 0; i < N; ++i) {
+      table[i] = static_cast<float>(
+          constexprSin(i * 2 * 3.14159265358979323846 / N));
+    }
+    return table;
+  }();
+
+  std::array<sf::Vector2f, N> points;
+  float maxRadius = 0;
+
+  void setRadii(const std::array<float, N>& radii) {
+    this->maxRadius = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+      this->points[i] = {radii[i] * COS[i], radii[i] * SIN[i]};
+      this->maxRadius = std::max(this->maxRadius, radii[i]);
+    }
+  }
+
+  void applyTo(sf::ConvexShape& shape) const {
+    shape.setPointCount(N);
+    for (std::size_t i = 0; i < N; ++i) {
+      shape.setPoint(i, this->points[i]);
+    }
+  }
+
+  // Index of the vertex starting the slice between two vertex directions
+  // that local point p lies in
+  std::size_t sector(const sf::Vector2f& p) const {
+    return sector(p, std::make_index_sequence<N>{});
+  }
+
+  // Whether local point p is inside, i.e. on the origin side of the edge
+  // closing its sector. Exact for any radii, unlike a convex polygon test.
+  bool contains(const sf::Vector2f& p) const {
+    if (p.x * p.x + p.y * p.y >= this->maxRadius * this->maxRadius) {
+      return false;
+    }
+    std::size_t i = sector(p);
+    const sf::Vector2f& a = this->points[i];
+    const sf::Vector2f& b = this->points[i + 1 == N ? 0 : i + 1];
+    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x) > 0;
+  }
+
+ private:
+  // Branch free, the sector of a random point would mispredict every time
+  template <std::size_t... I>
+  static std::size_t sector(const sf::Vector2f& p, std::index_sequence<I...>) {
+    // Bit I is set when p is counterclockwise of direction I, p's sector
+    // starts where a set bit is followed by a clear one
+    uint32_t ccw = ((uint32_t(COS[I] * p.y - SIN[I] * p.x >= 0) << I) | ...);
+    uint32_t next = (ccw >> 1) | (ccw << (N - 1));
+    uint32_t starts = ccw & ~next & ((1u << N) - 1);
+    // No start only happens at the origin, which every sector contains
+    std::size_t i = std::countr_zero(starts);
+    return i == 32 ? 0 : i;
+  }
+};
@@ -0,0 +1,122 @@
+// Benchmark for the fixed vertex count polygons: times point containment and
+// vertex transforms against the runtime-count ConvexShape versions in
+// game.hpp, and reports how often the two containment tests agree.
+//
+// Usage: polygon_bench [points]
+// The radial tests can disagree near edges: isPointInsideRadialPolygon
+// interpolates the radius by angle, RadialPolygon tests the actual edge.
+
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "game.hpp"
+#include "polygon.hpp"
+#include "util.hpp"
+
+// Runs fn over every point, returns ns per call and the number of hits
+template <typename Fn>
+std::pair<double, long> timeTest(const std::vector<sf::Vector2f>& points,
+                                 Fn&& fn) {
+  long hits = 0;
+  auto start = now();
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    hits += fn(i, points[i]);
+  }
+  std::chrono::duration<double, std::nano> elapsed = now() - start;
+  return {elapsed.count() / points.size(), hits};
+}
+
+void report(const char* name, std::pair<double, long> runtime,
+            std::pair<double, long> fixed, long agree, std::size_t count) {
+  print(std::left, std::setw(22), name, std::right, "runtime: ", std::fixed,
+        std::setprecision(2), std::setw(6), runtime.first,
+        " ns  fixed: ", std::setw(6), fixed.first, " ns  speedup: ",
+        std::setw(5), runtime.first / fixed.first, "x  hits: ", runtime.second,
+        " / ", fixed.second, "  agree: ", std::setprecision(3),
+        100.0 * agree / count, "%");
+}
+
+int main(int argc, char** argv) {
+  std::size_t count = argc > 1 ? std::stoul(argv[1]) : 2'000'000;
+
+  // 256 asteroids of mixed sizes, points scattered around their centers
+  std::vector<Asteroid> asteroids;
+  for (int i = 0; i < 256; ++i) {
+    asteroids.emplace_back(randomVector2f(-900, 900, -500, 500), vec(0, 0),
+                           static_cast<Asteroid::AsteroidSize>(i % 3));
+  }
+  std::vector<sf::Vector2f> points(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto& asteroid = asteroids[i % asteroids.size()];
+    points[i] = asteroid.shape.getPosition() +
+                randomVector2f(-1.2f, 1.2f, -1.2f, 1.2f) *
+                    asteroid.outline.maxRadius;
+  }
+
+  auto radialRuntime = timeTest(points, [&](std::size_t i, auto P) {
+    return isPointInsideRadialPolygon(P, asteroids[i % 256].shape,
+                                      Asteroid::BIG_RADIUS * 2, false);
+  });
+  auto radialFixed = timeTest(points, [&](std::size_t i, auto P) {
+    const auto& asteroid = asteroids[i % 256];
+    return asteroid.outline.contains(P - asteroid.shape.getPosition());
+  });
+  long agree = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto& asteroid = asteroids[i % 256];
+    agree += isPointInsideRadialPolygon(points[i], asteroid.shape,
+                                        Asteroid::BIG_RADIUS * 2, false) ==
+             asteroid.outline.contains(points[i] - asteroid.shape.getPosition());
+  }
+  report("RadialPolygon<8>", radialRuntime, radialFixed, agree, count);
+
+  // Ships at random positions and rotations, points around them
+  std::vector<Ship> ships(256);
+  for (auto& ship : ships) {
+    ship.shape.setPosition(randomVector2f(-900, 900, -500, 500));
+    ship.shape.setRotation(randomFloat(0, 360));
+  }
+  for (std::size_t i = 0; i < count; ++i) {
+    points[i] = ships[i % ships.size()].shape.getPosition() +
+                randomVector2f(-12, 12, -12, 12);
+  }
+
+  auto convexRuntime = timeTest(points, [&](std::size_t i, auto P) {
+    return isPointInsideConvexPolygon(P, ships[i % 256].shape, 0);
+  });
+  auto convexFixed = timeTest(points, [&](std::size_t i, auto P) {
+    return Ship::HULL.contains(P, ships[i % 256].shape.getTransform());
+  });
+  agree = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto& shape = ships[i % 256].shape;
+    agree += isPointInsideConvexPolygon(points[i], shape, 0) ==
+             Ship::HULL.contains(points[i], shape.getTransform());
+  }
+  report("FixedPolygon<3>", convexRuntime, convexFixed, agree, count);
+
+  // Transforming the ship's vertices to world space, as the collision check
+  // does every frame. Hits counts vertices left of the ship's position.
+  auto transformRuntime = timeTest(points, [&](std::size_t i, auto) {
+    const auto& shape = ships[i % 256].shape;
+    const auto& transform = shape.getTransform();
+    int left = 0;
+    for (std::size_t j = 0; j < shape.getPointCount(); ++j) {
+      left += transform.transformPoint(shape.getPoint(j)).x <
+              shape.getPosition().x;
+    }
+    return left;
+  });
+  auto transformFixed = timeTest(points, [&](std::size_t i, auto) {
+    const auto& shape = ships[i % 256].shape;
+    int left = 0;
+    for (const auto& pt : Ship::HULL.transformed(shape.getTransform())) {
+      left += pt.x < shape.getPosition().x;
+    }
+    return left;
+  });
+  report("transform 3 points", transformRuntime, transformFixed,
+         transformRuntime.second == transformFixed.second ? count : 0, count);
+}
@@ -0,0 +1,730 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RASTER_SSE2 1
+#endif
+
+#include "util.hpp"
+#include "worker_pool.hpp"
+
+/**** Framebuffer ****/
+
+// std::floor and std::ceil are library calls without SSE4.1, and they sit in
+// the innermost rasterizer loops
+inline int floorToInt(float x) {
+  int i = static_cast<int>(x);
+  return i - (x < static_cast<float>(i));
+}
+
+inline int ceilToInt(float x) {
+  int i = static_cast<int>(x);
+  return i + (x > static_cast<float>(i));
+}
+
+// Rounds halfway cases away from zero like std::lround, which is a library
+// call as well. x minus its truncation is exact.
+inline int roundToInt(float x) {
+  int i = static_cast<int>(x);
+  float fraction = x - static_cast<float>(i);
+  return i + (fraction >= 0.5f) - (fraction <= -0.5f);
+}
+
+// Packs a color into 4 bytes laid out as R, G, B, A in memory, which is the
+// pixel format sf::Image expects
+inline uint32_t packColor(const sf::Color& color) {
+  const uint8_t bytes[4] = {color.r, color.g, color.b, color.a};
+  uint32_t packed;
+  std::memcpy(&packed, bytes, sizeof(packed));
+  return packed;
+}
+
+inline sf::Color unpackColor(uint32_t packed) {
+  uint8_t bytes[4];
+  std::memcpy(bytes, &packed, sizeof(packed));
+  return {bytes[0], bytes[1], bytes[2], bytes[3]};
+}
+
+// Fills pixels [x0, x1) of a row with a single packed color
+inline void fillSpan(uint32_t* row, int x0, int x1, uint32_t color) {
+  int x = x0;
+#ifdef RASTER_SSE2
+  const __m128i c = _mm_set1_epi32(static_cast<int>(color));
+  for (; x + 16 <= x1; x += 16) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), c);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x + 4), c);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x + 8), c);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x + 12), c);
+  }
+  for (; x + 4 <= x1; x += 4) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), c);
+  }
+  // Spans of 4 or more finish with one store overlapping the last one
+  if (x < x1 && x1 - x0 >= 4) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x1 - 4), c);
+    return;
+  }
+#endif
+  for (; x < x1; ++x) {
+    row[x] = color;
+  }
+}
+
+// Alpha blends a color over pixels [x0, x1) of a row
+inline void blendSpan(uint32_t* row, int x0, int x1, const sf::Color& color) {
+  const uint32_t a = color.a;
+  const uint32_t inv = 255 - a;
+  for (int x = x0; x < x1; ++x) {
+    sf::Color dst = unpackColor(row[x]);
+    dst.r = static_cast<uint8_t>((color.r * a + dst.r * inv) / 255);
+    dst.g = static_cast<uint8_t>((color.g * a + dst.g * inv) / 255);
+    dst.b = static_cast<uint8_t>((color.b * a + dst.b * inv) / 255);
+    dst.a = static_cast<uint8_t>(a + dst.a * inv / 255);
+    row[x] = packColor(dst);
+  }
+}
+
+// In-memory RGBA8 image, row-major with the origin at the top left
+struct Framebuffer {
+  unsigned width;
+  unsigned height;
+  std::vector<uint32_t> pixels;
+
+  Framebuffer(unsigned width, unsigned height)
+      : width(width), height(height), pixels(std::size_t(width) * height) {}
+
+  uint32_t* row(int y) { return this->pixels.data() + std::size_t(y) * width; }
+
+  void clear(const sf::Color& color = sf::Color::Black) {
+    fillSpan(this->pixels.data(), 0, static_cast<int>(this->pixels.size()),
+             packColor(color));
+  }
+
+  // Saves through sf::Image, so the format follows the file extension
+  // (png, bmp, tga, jpg)
+  bool saveToFile(const std::string& path) const {
+    sf::Image image;
+    image.create(width, height,
+                 reinterpret_cast<const sf::Uint8*>(this->pixels.data()));
+    return image.saveToFile(path);
+  }
+
+  // Binary PPM (P6), alpha is dropped
+  bool savePPM(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+      return false;
+    }
+    out << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<char> rgb(std::size_t(width) * height * 3);
+    for (std::size_t i = 0; i < this->pixels.size(); ++i) {
+      sf::Color c = unpackColor(this->pixels[i]);
+      rgb[i * 3] = static_cast<char>(c.r);
+      rgb[i * 3 + 1] = static_cast<char>(c.g);
+      rgb[i * 3 + 2] = static_cast<char>(c.b);
+    }
+    out.write(rgb.data(), static_cast<std::streamsize>(rgb.size()));
+    return static_cast<bool>(out);
+  }
+};
+
+/**** CPU Rasterizer ****/
+
+// Software replacement for sf::RenderWindow on machines without a GPU, with
+// the same clear()/draw()/display() cycle. Draws are transformed to pixel
+// space and recorded, and each one is listed in the bands of rows it touches.
+// display() then rasterizes band by band so the rows being written stay in
+// cache. Bands don't share any state, so with a WorkerPool they run in
+// parallel.
+// Within a band the opaque draws after the last translucent one are
+// rasterized front to back. A coverage bit per pixel records what a nearer
+// draw already wrote and spans only fill the pixels still uncovered. A draw
+// whose 64x64 tiles are all covered is skipped without walking its rows,
+// and the band stops once every tile is covered, so a crowded frame costs
+// about as much as the draws that are actually visible. The remaining
+// draws then fill in what is left, back to front.
+// Limitations: no text or textures, outlines are drawn 1px wide regardless of
+// their thickness, and polygons are capped at MAX_POINTS vertices.
+struct CpuRasterizer {
+  static constexpr std::size_t MAX_POINTS = 64;
+  static constexpr int BAND_HEIGHT = 64;
+
+  // A recorded primitive, its points are in pixel space
+  struct Command {
+    enum Kind { POLYGON, OUTLINE, LINE, POINT };
+
+    Kind kind;
+    uint32_t first;  // index into points
+    uint32_t count;
+    sf::Color color;
+    float radius;  // POINT only
+    int top;       // first and last row touched
+    int bottom;
+    int left;  // first and last column touched
+    int right;
+  };
+
+  Framebuffer frame;
+  sf::Transform viewTransform;  // world -> pixel coordinates
+  WorkerPool* pool = nullptr;   // Bands are split across it when set
+
+  std::vector<Command> commands;
+  std::vector<sf::Vector2f> points;
+  std::vector<std::vector<uint32_t>> bands;  // Commands touching each band
+  bool shouldClear = false;
+  sf::Color clearColor;
+
+  // Per row x crossings used by fillPolygon, MAX_POINTS slots per frame row
+  std::vector<float> crossings;
+  std::vector<uint8_t> crossingCounts;
+
+  // Occlusion state. A bit per pixel written by a nearer draw, kept by frame
+  // row like crossings, with the bits past the right edge always set. A tile
+  // is one coverage word across a band, fullRows counts the rows in which
+  // its word is all set, and the tile is covered when that reaches the band
+  // height.
+  int coverageWords;  // per row
+  std::vector<uint64_t> coverage;
+  std::vector<uint8_t> fullRows;   // per band and coverage word
+  std::vector<int> coveredTiles;   // per band
+
+  CpuRasterizer(unsigned width, unsigned height)
+      : frame(width, height),
+        bands((height + BAND_HEIGHT - 1) / BAND_HEIGHT),
+        crossings(std::size_t(height) * MAX_POINTS),
+        crossingCounts(height),
+        coverageWords((width + 63) / 64),
+        coverage(std::size_t(height) * coverageWords),
+        fullRows(bands.size() * coverageWords),
+        coveredTiles(bands.size()) {
+    sf::View view;
+    view.setCenter(width / 2.f, height / 2.f);
+    view.setSize(static_cast<float>(width), static_cast<float>(height));
+    setView(view);
+    // Room for a couple of thousand shapes, so the command buffers don't
+    // grow in the middle of a game
+    this->commands.reserve(4096);
+    this->points.reserve(16384);
+    for (auto& band : this->bands) {
+      band.reserve(4096);
+    }
+  }
+
+  // Same mapping as sf::RenderTarget::setView with the default viewport
+  void setView(const sf::View& view) {
+    float w = static_cast<float>(frame.width);
+    float h = static_cast<float>(frame.height);
+    sf::Transform ndcToPixel(w / 2, 0, w / 2,  //
+                             0, -h / 2, h / 2,  //
+                             0, 0, 1);
+    this->viewTransform = ndcToPixel * view.getTransform();
+  }
+
+  // Anything recorded before a clear would be painted over, so drop it
+  void clear(const sf::Color& color = sf::Color::Black) {
+    this->commands.clear();
+    this->points.clear();
+    for (auto& band : this->bands) {
+      band.clear();
+    }
+    this->shouldClear = true;
+    this->clearColor = color;
+  }
+
+  void draw(const sf::Drawable& drawable,
+            const sf::RenderStates& states = sf::RenderStates::Default) {
+    if (auto* shape = dynamic_cast<const sf::Shape*>(&drawable)) {
+      draw(*shape, states);
+    } else if (auto* line = dynamic_cast<const Line*>(&drawable)) {
+      draw(line->vertices.get(), line->vertexCount, line->type, states);
+    }
+    // Anything else (sf::Text, sprites) needs the GPU and is skipped
+  }
+
+  void draw(const sf::Shape& shape,
+            const sf::RenderStates& states = sf::RenderStates::Default) {
+    std::size_t n = std::min(shape.getPointCount(), MAX_POINTS);
+    if (n < 2) {
+      return;
+    }
+    sf::Transform transform =
+        this->viewTransform * states.transform * shape.getTransform();
+    sf::Vector2f pts[MAX_POINTS];
+    for (std::size_t i = 0; i < n; ++i) {
+      pts[i] = transform.transformPoint(shape.getPoint(i));
+    }
+
+    addPolygon(pts, n, shape.getFillColor());
+    if (shape.getOutlineThickness() != 0) {
+      record(Command::OUTLINE, pts, n, shape.getOutlineColor());
+    }
+  }
+
+  void draw(const sf::Vertex* vertices, std::size_t vertexCount,
+            sf::PrimitiveType type,
+            const sf::RenderStates& states = sf::RenderStates::Default) {
+    sf::Transform transform = this->viewTransform * states.transform;
+    auto px = [&](std::size_t i) {
+      return transform.transformPoint(vertices[i].position);
+    };
+    switch (type) {
+      case sf::Points:
+        for (std::size_t i = 0; i < vertexCount; ++i) {
+          addPoint(px(i), 0, vertices[i].color);
+        }
+        break;
+      case sf::Lines:
+        for (std::size_t i = 0; i + 1 < vertexCount; i += 2) {
+          addLine(px(i), px(i + 1), vertices[i].color);
+        }
+        break;
+      case sf::LineStrip:
+        for (std::size_t i = 0; i + 1 < vertexCount; ++i) {
+          addLine(px(i), px(i + 1), vertices[i].color);
+        }
+        break;
+      case sf::Triangles:
+        for (std::size_t i = 0; i + 2 < vertexCount; i += 3) {
+          sf::Vector2f tri[3] = {px(i), px(i + 1), px(i + 2)};
+          addPolygon(tri, 3, vertices[i].color);
+        }
+        break;
+      case sf::TriangleStrip:
+        for (std::size_t i = 0; i + 2 < vertexCount; ++i) {
+          sf::Vector2f tri[3] = {px(i), px(i + 1), px(i + 2)};
+          addPolygon(tri, 3, vertices[i].color);
+        }
+        break;
+      case sf::TriangleFan:
+        for (std::size_t i = 1; i + 1 < vertexCount; ++i) {
+          sf::Vector2f tri[3] = {px(0), px(i), px(i + 1)};
+          addPolygon(tri, 3, vertices[0].color);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  // World space helpers matching LayeredDrawer::line and LayeredDrawer::point
+  void line(const sf::Vector2f start, const sf::Vector2f end,
+            const sf::Color& color = sf::Color::White) {
+    addLine(viewTransform.transformPoint(start),
+            viewTransform.transformPoint(end), color);
+  }
+
+  void point(const sf::Vector2f point, const sf::Color& color = sf::Color::Red,
+             float radius = 2) {
+    addPoint(viewTransform.transformPoint(point), radius, color);
+  }
+
+  // Rasterizes everything recorded since the last clear into frame
+  void display() {
+    // Only captures this, so the std::function the pool takes doesn't
+    // allocate
+    auto rasterize = [this](std::size_t begin, std::size_t end) {
+      for (std::size_t band = begin; band < end; ++band) {
+        rasterizeBand(static_cast<int>(band));
+      }
+    };
+    if (this->pool) {
+      this->pool->run(this->bands.size(), rasterize);
+    } else {
+      rasterize(0, this->bands.size());
+    }
+    this->commands.clear();
+    this->points.clear();
+    for (auto& band : this->bands) {
+      band.clear();
+    }
+    this->shouldClear = false;
+  }
+
+  void rasterizeBand(int band) {
+    const int bandTop = band * BAND_HEIGHT;
+    const int bandBottom =
+        std::min(static_cast<int>(frame.height), bandTop + BAND_HEIGHT) - 1;
+    const int bandRows = bandBottom - bandTop + 1;
+    const int width = static_cast<int>(frame.width);
+    const uint64_t outside = width % 64 ? ~0ull << (width % 64) : 0;
+    for (int y = bandTop; y <= bandBottom; ++y) {
+      uint64_t* words = &this->coverage[std::size_t(y) * coverageWords];
+      std::fill_n(words, coverageWords, 0);
+      words[coverageWords - 1] = outside;
+    }
+    std::fill_n(&this->fullRows[std::size_t(band) * coverageWords],
+                coverageWords, 0);
+    this->coveredTiles[band] = 0;
+    if (this->shouldClear) {
+      fillSpan(frame.row(bandTop), 0, bandRows * width,
+               packColor(this->clearColor));
+    }
+
+    // Opaque draws after the last translucent one, nearest first
+    const std::vector<uint32_t>& indices = this->bands[band];
+    std::size_t back = indices.size();
+    const uint8_t* tiles = &this->fullRows[std::size_t(band) * coverageWords];
+    for (; back > 0 && this->coveredTiles[band] < coverageWords; --back) {
+      const Command& cmd = this->commands[indices[back - 1]];
+      if (cmd.color.a != 255) {
+        break;
+      }
+      bool hidden = true;
+      for (int w = cmd.left >> 6; w <= cmd.right >> 6 && hidden; ++w) {
+        hidden = tiles[w] == bandRows;
+      }
+      if (hidden) {
+        continue;
+      }
+      // Rows at either end already covered across the draw need no work
+      int top = std::max(cmd.top, bandTop);
+      int bottom = std::min(cmd.bottom, bandBottom);
+      while (top <= bottom && isCovered(top, cmd.left, cmd.right)) {
+        ++top;
+      }
+      while (top <= bottom && isCovered(bottom, cmd.left, cmd.right)) {
+        --bottom;
+      }
+      if (top <= bottom) {
+        rasterize(cmd, true, top, bottom);
+      }
+    }
+
+    if (this->coveredTiles[band] == coverageWords) {
+      return;
+    }
+
+    // Then the rest in order, behind what is already there
+    for (std::size_t i = 0; i < back; ++i) {
+      rasterize(this->commands[indices[i]], false, bandTop, bandBottom);
+    }
+  }
+
+  // With cover the pixels written are marked covered, either way covered
+  // pixels are left alone
+  void rasterize(const Command& cmd, bool cover, int rowTop, int rowBottom) {
+    const sf::Vector2f* pts = &this->points[cmd.first];
+    switch (cmd.kind) {
+      case Command::POLYGON:
+        fillPolygon(pts, cmd.count, cmd.color, cover, rowTop, rowBottom);
+        break;
+      case Command::OUTLINE:
+        for (uint32_t i = 0; i < cmd.count; ++i) {
+          pixelLine(pts[i], pts[i + 1 == cmd.count ? 0 : i + 1], cmd.color,
+                    cover, rowTop, rowBottom);
+        }
+        break;
+      case Command::LINE:
+        pixelLine(pts[0], pts[1], cmd.color, cover, rowTop, rowBottom);
+        break;
+      case Command::POINT:
+        pixelPoint(pts[0], cmd.radius, cmd.color, cover, rowTop, rowBottom);
+        break;
+    }
+  }
+
+  // Fills or blends the uncovered pixels of [x0, x1) in row y, merging runs
+  // of them across coverage words into one fillSpan
+  void coverSpan(int y, int x0, int x1, const sf::Color& color,
+                 uint32_t packed, bool cover) {
+    uint64_t* words = &this->coverage[std::size_t(y) * coverageWords];
+    uint32_t* row = frame.row(y);
+    const bool opaque = color.a == 255;
+    int runStart = 0, runEnd = 0;
+    auto flush = [&] {
+      if (runStart < runEnd && opaque) {
+        fillSpan(row, runStart, runEnd, packed);
+      } else if (runStart < runEnd) {
+        blendSpan(row, runStart, runEnd, color);
+      }
+    };
+    const int last = (x1 - 1) >> 6;
+    for (int w = x0 >> 6; w <= last; ++w) {
+      uint64_t open = ~words[w];
+      if (w == x0 >> 6) {
+        open &= ~0ull << (x0 & 63);
+      }
+      if (w == last) {
+        open &= ~0ull >> (63 - ((x1 - 1) & 63));
+      }
+      if (!open) {
+        continue;
+      }
+      if (cover) {
+        words[w] |= open;
+        if (words[w] == ~0ull) {
+          fillRow(y, w);
+        }
+      }
+      while (open) {
+        int start = std::countr_zero(open);
+        int begin = w * 64 + start;
+        if (begin != runEnd) {
+          flush();
+          runStart = begin;
+        }
+        runEnd = begin + std::countr_one(open >> start);
+        open &= open + (open & (~open + 1));  // drops the lowest run
+      }
+    }
+    flush();
+  }
+
+  // coverSpan for a single pixel, which is what lines are drawn with
+  void coverPixel(int y, int x, const sf::Color& color, uint32_t packed,
+                  bool cover) {
+    uint64_t& word = this->coverage[std::size_t(y) * coverageWords + (x >> 6)];
+    const uint64_t bit = 1ull << (x & 63);
+    if (word & bit) {
+      return;
+    }
+    if (color.a == 255) {
+      frame.row(y)[x] = packed;
+    } else {
+      blendSpan(frame.row(y), x, x + 1, color);
+    }
+    if (cover) {
+      word |= bit;
+      if (word == ~0ull) {
+        fillRow(y, x >> 6);
+      }
+    }
+  }
+
+  // Whether pixels [x0, x1] of row y are all covered
+  bool isCovered(int y, int x0, int x1) const {
+    const uint64_t* words = &this->coverage[std::size_t(y) * coverageWords];
+    const int first = x0 >> 6, last = x1 >> 6;
+    for (int w = first; w <= last; ++w) {
+      uint64_t mask = ~0ull;
+      if (w == first) {
+        mask &= ~0ull << (x0 & 63);
+      }
+      if (w == last) {
+        mask &= ~0ull >> (63 - (x1 & 63));
+      }
+      if ((words[w] & mask) != mask) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Coverage word w of row y just became all set
+  void fillRow(int y, int w) {
+    const int band = y / BAND_HEIGHT;
+    const int rows =
+        std::min(BAND_HEIGHT, static_cast<int>(frame.height) - band * BAND_HEIGHT);
+    if (++this->fullRows[std::size_t(band) * coverageWords + w] == rows) {
+      ++this->coveredTiles[band];
+    }
+  }
+
+  /**** Recording ****/
+
+  void record(Command::Kind kind, const sf::Vector2f* pts, std::size_t n,
+              const sf::Color& color, float radius = 0) {
+    if (color.a == 0) {
+      return;
+    }
+    float minX = pts[0].x, maxX = pts[0].x;
+    float minY = pts[0].y, maxY = pts[0].y;
+    for (std::size_t i = 1; i < n; ++i) {
+      minX = std::min(minX, pts[i].x);
+      maxX = std::max(maxX, pts[i].x);
+      minY = std::min(minY, pts[i].y);
+      maxY = std::max(maxY, pts[i].y);
+    }
+    // Skip anything entirely outside the framebuffer
+    if (maxX + radius < 0 || minX - radius >= frame.width ||
+        maxY + radius < 0 || minY - radius >= frame.height) {
+      return;
+    }
+    int top = std::max(0, floorToInt(minY - radius));
+    int bottom = std::min(static_cast<int>(frame.height) - 1,
+                          floorToInt(maxY + radius));
+    int left = std::max(0, floorToInt(minX - radius));
+    int right = std::min(static_cast<int>(frame.width) - 1,
+                         floorToInt(maxX + radius));
+    auto index = static_cast<uint32_t>(this->commands.size());
+    this->commands.push_back({kind, static_cast<uint32_t>(points.size()),
+                              static_cast<uint32_t>(n), color, radius, top,
+                              bottom, left, right});
+    this->points.insert(this->points.end(), pts, pts + n);
+    for (int band = top / BAND_HEIGHT; band <= bottom / BAND_HEIGHT; ++band) {
+      this->bands[band].push_back(index);
+    }
+  }
+
+  void addPolygon(const sf::Vector2f* pts, std::size_t n,
+                  const sf::Color& color) {
+    if (n >= 3) {
+      record(Command::POLYGON, pts, std::min(n, MAX_POINTS), color);
+    }
+  }
+
+  void addLine(sf::Vector2f a, sf::Vector2f b, const sf::Color& color) {
+    sf::Vector2f pts[2] = {a, b};
+    record(Command::LINE, pts, 2, color);
+  }
+
+  void addPoint(sf::Vector2f p, float radius, const sf::Color& color) {
+    record(Command::POINT, &p, 1, color, radius);
+  }
+
+  /**** Rasterization, all in pixel space within rows [rowTop, rowBottom] ****/
+
+  // Scanline fill of a simple polygon using the even-odd rule, sampling at
+  // pixel centers. Edges are walked once to bucket their x crossings per row,
+  // then each row's spans are filled with coverSpan. Crossings are kept by
+  // frame row, so bands running in parallel don't share any.
+  void fillPolygon(const sf::Vector2f* pts, std::size_t n,
+                   const sf::Color& color, bool cover, int rowTop,
+                   int rowBottom) {
+    float minY = pts[0].y, maxY = pts[0].y;
+    for (std::size_t i = 1; i < n; ++i) {
+      minY = std::min(minY, pts[i].y);
+      maxY = std::max(maxY, pts[i].y);
+    }
+    int y0 = std::max(rowTop, ceilToInt(minY - 0.5f));
+    int y1 = std::min(rowBottom, floorToInt(maxY - 0.5f));
+    if (y0 > y1) {
+      return;
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+      sf::Vector2f a = pts[i];
+      sf::Vector2f b = pts[i + 1 == n ? 0 : i + 1];
+      if (a.y == b.y) {
+        continue;
+      }
+      if (a.y > b.y) {
+        std::swap(a, b);
+      }
+      // Rows whose center satisfies a.y <= y + 0.5 < b.y
+      int top = std::max(y0, ceilToInt(a.y - 0.5f));
+      int bottom = std::min(y1, ceilToInt(b.y - 0.5f) - 1);
+      float dxdy = (b.x - a.x) / (b.y - a.y);
+      float x = a.x + (top + 0.5f - a.y) * dxdy;
+      for (int y = top; y <= bottom; ++y, x += dxdy) {
+        this->crossings[std::size_t(y) * MAX_POINTS + crossingCounts[y]++] = x;
+      }
+    }
+
+    const uint32_t packed = packColor(color);
+    const int width = static_cast<int>(frame.width);
+    for (int y = y0; y <= y1; ++y) {
+      float* xs = &this->crossings[std::size_t(y) * MAX_POINTS];
+      int count = crossingCounts[y];
+      crossingCounts[y] = 0;
+      // Almost always 2 crossings
+      if (count == 2) {
+        float left = std::min(xs[0], xs[1]), right = std::max(xs[0], xs[1]);
+        int x0 = std::max(0, ceilToInt(left - 0.5f));
+        int x1 = std::min(width, ceilToInt(right - 0.5f));
+        if (x0 < x1) {
+          coverSpan(y, x0, x1, color, packed, cover);
+        }
+        continue;
+      }
+      // Insertion sort for the rest
+      for (int i = 1; i < count; ++i) {
+        for (int j = i; j > 0 && xs[j - 1] > xs[j]; --j) {
+          std::swap(xs[j - 1], xs[j]);
+        }
+      }
+      for (int i = 0; i + 1 < count; i += 2) {
+        int x0 = std::max(0, ceilToInt(xs[i] - 0.5f));
+        int x1 = std::min(width, ceilToInt(xs[i + 1] - 0.5f));
+        if (x0 < x1) {
+          coverSpan(y, x0, x1, color, packed, cover);
+        }
+      }
+    }
+  }
+
+  // 1px DDA line. The steps walked are clipped to the rows and columns that
+  // can land in the frame, and a horizontal line is a single span.
+  void pixelLine(sf::Vector2f a, sf::Vector2f b, const sf::Color& color,
+                 bool cover, int rowTop, int rowBottom) {
+    const uint32_t packed = packColor(color);
+    const int width = static_cast<int>(frame.width);
+    if (std::max(a.y, b.y) < rowTop || std::min(a.y, b.y) >= rowBottom + 1 ||
+        std::max(a.x, b.x) < 0 || std::min(a.x, b.x) >= width) {
+      return;
+    }
+    if (a.y == b.y) {
+      int y = floorToInt(a.y);
+      int x0 = std::max(0, floorToInt(std::min(a.x, b.x)));
+      int x1 = std::min(width, floorToInt(std::max(a.x, b.x)) + 1);
+      if (y >= rowTop && y <= rowBottom && x0 < x1) {
+        coverSpan(y, x0, x1, color, packed, cover);
+      }
+      return;
+    }
+
+    sf::Vector2f d = b - a;
+    int steps = std::max(1, static_cast<int>(std::max(std::abs(d.x),
+                                                      std::abs(d.y))));
+    sf::Vector2f step = d / static_cast<float>(steps);
+
+    // Steps where p lies in [low, high) along one axis, widened by a step on
+    // each side for rounding
+    int first = 0, last = steps;
+    auto clip = [&](float start, float delta, float low, float high) {
+      float t0 = (low - start) / delta;
+      float t1 = (high - start) / delta;
+      if (t0 > t1) {
+        std::swap(t0, t1);
+      }
+      first = std::max(first, floorToInt(t0) - 1);
+      last = std::min(last, ceilToInt(t1) + 1);
+    };
+    clip(a.y, step.y, static_cast<float>(rowTop),
+         static_cast<float>(rowBottom + 1));
+    if (step.x != 0) {
+      clip(a.x, step.x, 0, static_cast<float>(width));
+    }
+
+    // Walked in 16.16 fixed point, the clipping keeps p within a step or
+    // two of the frame so it can't overflow
+    sf::Vector2f p = a + step * static_cast<float>(first);
+    int32_t fx = roundToInt(p.x * 65536.f);
+    int32_t fy = roundToInt(p.y * 65536.f);
+    const int32_t sx = roundToInt(step.x * 65536.f);
+    const int32_t sy = roundToInt(step.y * 65536.f);
+    for (int i = first; i <= last; ++i, fx += sx, fy += sy) {
+      int x = fx >> 16;
+      int y = fy >> 16;
+      if (static_cast<unsigned>(x) >= static_cast<unsigned>(width) ||
+          y < rowTop || y > rowBottom) {
+        continue;
+      }
+      coverPixel(y, x, color, packed, cover);
+    }
+  }
+
+  // Filled square of half-size radius centered on p
+  void pixelPoint(sf::Vector2f p, float radius, const sf::Color& color,
+                  bool cover, int rowTop, int rowBottom) {
+    int x0 = std::max(0, floorToInt(p.x - radius));
+    int x1 = std::min(static_cast<int>(frame.width),
+                      floorToInt(p.x + radius) + 1);
+    int y0 = std::max(rowTop, floorToInt(p.y - radius));
+    int y1 = std::min(rowBottom, floorToInt(p.y + radius));
+    const uint32_t packed = packColor(color);
+    for (int y = y0; y <= y1 && x0 < x1; ++y) {
+      coverSpan(y, x0, x1, color, packed, cover);
+    }
+  }
+};
@@ -0,0 +1,398 @@
+// Headless multiplayer server. Owns the simulation that main() runs locally,
+// with one ship per connected client, and sends each client delta-encoded
+// snapshots against the last snapshot it acknowledged.
+//
+// Rounds, scoring and splits use the rules in game.hpp. What differs from
+// main():
+// - A hit ship respawns on its own after RESPAWN_TICKS with its score
+//   cleared, instead of the game over screen resetting the whole game.
+// - A ship has at most MAX_BULLETS_PER_SHIP bullets in flight, which keeps
+//   snapshots bounded with many players. main() has no limit, one shot per
+//   frame lives bulletRange / bulletVelocity frames.
+// - An asteroid hit by two bullets in one tick splits once and scores for
+//   the first bullet's owner, like in VecEnv. main() splits it for each
+//   bullet.
+//
+// Usage: server [port]
+
+#include <SFML/Graphics.hpp>
+#include <SFML/Network.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game.hpp"
+#include "net.hpp"
+#include "util.hpp"
+
+const int RESPAWN_TICKS = 300;  // same delay as the game over screen
+const int TIMEOUT_TICKS = 5 * TICK_RATE;
+const int MAX_BULLETS_PER_SHIP = 16;
+
+struct Player {
+  uint32_t id;
+  sf::IpAddress address;
+  unsigned short port;
+  Ship ship;
+  bool alive = true;
+  long respawnTick = 0;
+  uint score = 0;
+  uint8_t action = 0;
+  bool shootPending = false;  // SHOOT seen since the last tick
+  uint32_t ackTick = 0;
+  long lastHeardTick = 0;
+};
+
+struct ServerBullet {
+  uint32_t id;
+  uint32_t owner;
+  Bullet bullet;
+  BulletState spawn;  // what clients extrapolate from
+};
+
+bool hitsAsteroid(Asteroid& asteroid, const sf::Vector2f& P) {
+  float r = Asteroid::boundingRadius(asteroid.size);
+  sf::Vector2f d = P - asteroid.shape.getPosition();
+  return d.x * d.x + d.y * d.y < r * r &&
+         asteroid.isPointInsideAsteroid(P, false);
+}
+
+struct Server {
+  sf::UdpSocket socket;
+  std::map<std::pair<uint32_t, unsigned short>, Player> players;
+  std::vector<Asteroid> asteroids;
+  std::vector<ServerBullet> bullets;
+  SnapshotHistory history;
+  ByteWriter writer;
+  ByteWriter partWriter;  // SNAPSHOT_PART datagrams of writer's message
+
+  long tick = 1;
+  uint32_t nextPlayerId = 1;
+  uint32_t nextBulletId = 1;
+  int newRoundTick = 1;
+  int numAsteroids = START_ASTEROIDS;
+
+  // Per second stats
+  std::size_t bytesSent = 0;
+  std::size_t snapshotsSent = 0;
+
+  void receive() {
+    uint8_t buffer[sf::UdpSocket::MaxDatagramSize];
+    std::size_t received;
+    sf::IpAddress address;
+    unsigned short port;
+    while (socket.receive(buffer, sizeof(buffer), received, address, port) ==
+           sf::Socket::Done) {
+      ByteReader in(buffer, received);
+      uint8_t type = in.u8();
+      auto key = std::make_pair(address.toInteger(), port);
+
+      if (type == DISCONNECT) {
+        auto it = this->players.find(key);
+        if (it != this->players.end()) {
+          print("Player ", it->second.id, " left");
+          removeBullets(it->second.id);
+          this->players.erase(it);
+        }
+        continue;
+      }
+      if (type != INPUT) {
+        continue;
+      }
+      uint32_t ackTick = in.varint();
+      uint8_t action = in.u8();
+      if (!in.ok) {
+        continue;
+      }
+
+      auto it = this->players.find(key);
+      if (it == this->players.end()) {
+        Player player{.id = nextPlayerId++, .address = address, .port = port};
+        print("Player ", player.id, " joined from ", address.toString(), ":",
+              port);
+        it = this->players.emplace(key, std::move(player)).first;
+      }
+      Player& player = it->second;
+      player.action = action;
+      player.shootPending |= (action & INPUT_SHOOT) != 0;
+      player.ackTick = std::max(player.ackTick, ackTick);
+      player.lastHeardTick = tick;
+    }
+  }
+
+  void removeBullets(uint32_t owner) {
+    std::erase_if(this->bullets, [owner](const ServerBullet& b) {
+      return b.owner == owner;
+    });
+  }
+
+  // One frame of the main() loop for every ship
+  void update() {
+    std::erase_if(this->players, [this](const auto& entry) {
+      bool timedOut = tick - entry.second.lastHeardTick > TIMEOUT_TICKS;
+      if (timedOut) {
+        print("Player ", entry.second.id, " timed out");
+        removeBullets(entry.second.id);
+      }
+      return timedOut;
+    });
+
+    if (roundStarts(asteroids.size(), tick, newRoundTick)) {
+      numAsteroids += ROUND_GROWTH;
+      asteroids = generateAsteroids(numAsteroids, -FIELD_SIZE.x / 2,
+                                    FIELD_SIZE.x / 2, -FIELD_SIZE.y / 2,
+                                    FIELD_SIZE.y / 2);
+      bullets.clear();
+      // Like main(), every ship starts the round at the origin, where the
+      // wave leaves a clear zone
+      for (auto& [key, player] : players) {
+        player.ship.shape.setPosition(0, 0);
+        player.ship.velocity = {0, 0};
+      }
+    }
+
+    for (auto& [key, player] : this->players) {
+      Ship& ship = player.ship;
+      if (!player.alive) {
+        if (player.respawnTick == tick) {
+          player.alive = true;
+          player.score = 0;
+          ship.shape.setPosition(0, 0);
+          ship.shape.setRotation(0);
+          ship.velocity = {0, 0};
+        }
+        player.shootPending = false;
+        continue;
+      }
+
+      if (player.shootPending) {
+        player.shootPending = false;
+        long owned = std::count_if(
+            bullets.begin(), bullets.end(),
+            [&](const ServerBullet& b) { return b.owner == player.id; });
+        if (owned < MAX_BULLETS_PER_SHIP) {
+          Bullet bullet(ship.shape.getPosition(), ship.shape.getRotation());
+          BulletState spawn = makeBulletState(nextBulletId, bullet, tick);
+          bullets.push_back({nextBulletId++, player.id, bullet, spawn});
+        }
+      }
+
+      if (player.action & INPUT_THRUST) {
+        ship.velocity +=
+            move_forward(ship.shape.getRotation(), shipAcceleration);
+      } else if (std::abs(ship.velocity.x) > 0 ||
+                 std::abs(ship.velocity.y) > 0) {
+        ship.velocity +=
+            normalize(ship.velocity) *
+            -std::min(shipAcceleration / 2, magnitude(ship.velocity));
+      }
+      if (player.action & INPUT_LEFT) {
+        ship.shape.rotate(-2);
+      }
+      if (player.action & INPUT_RIGHT) {
+        ship.shape.rotate(2);
+      }
+      applyVelocityToObject(ship.shape, ship.velocity, FIELD_SIZE, false);
+    }
+
+    for (auto& asteroid : asteroids) {
+      applyVelocityToObject(asteroid.shape, asteroid.velocity, FIELD_SIZE,
+                            false);
+    }
+
+    std::vector<bool> bulletDead(bullets.size());
+    for (std::size_t i = 0; i < bullets.size(); ++i) {
+      Bullet& bullet = bullets[i].bullet;
+      applyVelocityToObject(bullet.shape, bullet.velocity, FIELD_SIZE, false);
+      bullet.range -= magnitude(bullet.velocity);
+      bulletDead[i] = bullet.range <= 0;
+    }
+
+    // Ships hit by asteroids die and respawn after RESPAWN_TICKS
+    for (auto& [key, player] : this->players) {
+      if (!player.alive) {
+        continue;
+      }
+      auto hull = Ship::HULL.transformed(player.ship.shape.getTransform());
+      bool hit = false;
+      for (auto& asteroid : asteroids) {
+        for (const auto& pt : hull) {
+          hit = hit || hitsAsteroid(asteroid, pt);
+        }
+        if (hit) {
+          break;
+        }
+      }
+      if (hit) {
+        player.alive = false;
+        player.respawnTick = tick + RESPAWN_TICKS;
+        for (std::size_t i = 0; i < bullets.size(); ++i) {
+          if (bullets[i].owner == player.id) {
+            bulletDead[i] = true;
+          }
+        }
+      }
+    }
+
+    // Bullets split asteroids and score for their owner
+    std::map<uint32_t, Player*> playersById;
+    for (auto& [key, player] : this->players) {
+      playersById[player.id] = &player;
+    }
+    std::vector<bool> asteroidDead(asteroids.size());
+    std::vector<Asteroid> asteroidsToAdd;
+    for (std::size_t i = 0; i < bullets.size(); ++i) {
+      if (bulletDead[i]) {
+        continue;
+      }
+      sf::Vector2f pos = bullets[i].bullet.shape.getPosition();
+      for (std::size_t j = 0; j < asteroids.size(); ++j) {
+        Asteroid& asteroid = asteroids[j];
+        if (asteroidDead[j] || !hitsAsteroid(asteroid, pos)) {
+          continue;
+        }
+        splitAsteroid(
+            asteroid.shape.getPosition(), asteroid.velocity, asteroid.size,
+            [](float min, float max) {
+              return randomVector2f(min, max, min, max);
+            },
+            [&](sf::Vector2f position, sf::Vector2f velocity,
+                Asteroid::AsteroidSize size) {
+              asteroidsToAdd.emplace_back(position, velocity, size);
+            });
+        auto owner = playersById.find(bullets[i].owner);
+        if (owner != playersById.end()) {
+          owner->second->score += asteroidScore(asteroid.size);
+        }
+        bulletDead[i] = true;
+        asteroidDead[j] = true;
+        break;
+      }
+    }
+
+    // Compact in place, keeping order like the erase calls in main()
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < bullets.size(); ++i) {
+      if (!bulletDead[i]) {
+        bullets[kept++] = std::move(bullets[i]);
+      }
+    }
+    bullets.erase(bullets.begin() + kept, bullets.end());
+    kept = 0;
+    for (std::size_t i = 0; i < asteroids.size(); ++i) {
+      if (!asteroidDead[i]) {
+        asteroids[kept++] = std::move(asteroids[i]);
+      }
+    }
+    asteroids.erase(asteroids.begin() + kept, asteroids.end());
+    asteroids.insert(asteroids.end(),
+                     std::make_move_iterator(asteroidsToAdd.begin()),
+                     std::make_move_iterator(asteroidsToAdd.end()));
+  }
+
+  Snapshot makeSnapshot() const {
+    Snapshot snapshot;
+    snapshot.tick = static_cast<uint32_t>(tick);
+    for (const auto& [key, player] : this->players) {
+      const sf::ConvexShape& shape = player.ship.shape;
+      ShipState state{player.id};
+      state.fields[SHIP_X] = quantizePosition(shape.getPosition().x);
+      state.fields[SHIP_Y] = quantizePosition(shape.getPosition().y);
+      state.fields[SHIP_ROTATION] = quantizeRotation(shape.getRotation());
+      state.fields[SHIP_ALIVE] = player.alive;
+      state.fields[SHIP_SCORE] = static_cast<int32_t>(player.score);
+      snapshot.ships.push_back(state);
+    }
+    for (const auto& asteroid : asteroids) {
+      snapshot.asteroids.push_back(makeAsteroidState(asteroid));
+    }
+    for (const auto& bullet : bullets) {
+      snapshot.bullets.push_back(bullet.spawn);
+    }
+
+    auto byId = [](const auto& a, const auto& b) { return a.id < b.id; };
+    std::sort(snapshot.ships.begin(), snapshot.ships.end(), byId);
+    std::sort(snapshot.asteroids.begin(), snapshot.asteroids.end(), byId);
+    std::sort(snapshot.bullets.begin(), snapshot.bullets.end(), byId);
+    return snapshot;
+  }
+
+  void sendSnapshots() {
+    Snapshot snapshot = makeSnapshot();
+    history.store(snapshot);
+    for (const auto& [key, player] : this->players) {
+      // Falls back to a full snapshot if the ack is too old or missing
+      const Snapshot* base = history.find(player.ackTick);
+      writer.bytes.clear();
+      writeSnapshot(writer, player.id, base, snapshot);
+      if (writer.bytes.size() <= MAX_PACKET_SIZE) {
+        socket.send(writer.bytes.data(), writer.bytes.size(), player.address,
+                    player.port);
+        bytesSent += writer.bytes.size();
+        ++snapshotsSent;
+        continue;
+      }
+      uint32_t parts = snapshotPartCount(writer.bytes.size());
+      if (parts > MAX_SNAPSHOT_PARTS) {
+        print("Snapshot for player ", player.id, " too large: ",
+              writer.bytes.size(), " bytes");
+        continue;
+      }
+      for (uint32_t part = 0; part < parts; ++part) {
+        partWriter.bytes.clear();
+        writeSnapshotPart(partWriter, writer.bytes, snapshot.tick, part);
+        socket.send(partWriter.bytes.data(), partWriter.bytes.size(),
+                    player.address, player.port);
+        bytesSent += partWriter.bytes.size();
+      }
+      ++snapshotsSent;
+    }
+  }
+
+  void run() {
+    auto tickDuration = std::chrono::nanoseconds(1'000'000'000 / TICK_RATE);
+    auto nextTick = now();
+    auto statsStart = now();
+    while (true) {
+      receive();
+      update();
+      if (tick % SNAPSHOT_INTERVAL == 0) {
+        sendSnapshots();
+      }
+
+      std::chrono::duration<double> statsElapsed = now() - statsStart;
+      if (statsElapsed.count() >= 1) {
+        print("tick ", tick, "  players: ", players.size(),
+              "  asteroids: ", asteroids.size(), "  bullets: ", bullets.size(),
+              "  avg snapshot: ",
+              snapshotsSent ? bytesSent / snapshotsSent : 0,
+              " B  out: ", std::fixed, std::setprecision(1),
+              bytesSent * 8 / 1000.0 / statsElapsed.count(), " kbit/s");
+        bytesSent = 0;
+        snapshotsSent = 0;
+        statsStart = now();
+      }
+
+      ++tick;
+      nextTick += tickDuration;
+      std::this_thread::sleep_until(nextTick);
+    }
+  }
+};
+
+int main(int argc, char** argv) {
+  unsigned short port = argc > 1 ? std::stoi(argv[1]) : DEFAULT_PORT;
+
+  Server server;
+  if (server.socket.bind(port) != sf::Socket::Done) {
+    print("Failed to bind UDP port ", port);
+    return 1;
+  }
+  server.socket.setBlocking(false);
+  print("Listening on UDP port ", port);
+  server.run();
+}
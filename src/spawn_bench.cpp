@@ -0,0 +1,138 @@
+// Benchmark for the WaveSpawner: spawns mixed waves of increasing size, on a
+// field grown with the count so they fit, and reports the time per wave and
+// per asteroid. Every wave is checked for asteroids closer than their
+// spacings and for asteroids inside the exclusion zone.
+//
+// Then spawns waves of big asteroids with spawnWave in a 1920x1080 view,
+// like the game does, up to far more than fit at their full spacing.
+//
+// Usage: spawn_bench [threads] [max count]
+
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game.hpp"
+#include "spawner.hpp"
+#include "util.hpp"
+#include "worker_pool.hpp"
+
+// Number of points closer than allowed, found with a bucket grid as coarse
+// as the largest allowed distance
+int countViolations(const WaveSpawner& spawner,
+                    const std::vector<WaveSpawner::Point>& points) {
+  float maxSpacing = 0;
+  for (float s : spawner.spacing) {
+    maxSpacing = std::max(maxSpacing, s);
+  }
+  float cell = 2 * maxSpacing;
+  int cols = static_cast<int>((spawner.max.x - spawner.min.x) / cell) + 1;
+  int rows = static_cast<int>((spawner.max.y - spawner.min.y) / cell) + 1;
+  std::vector<std::vector<int>> buckets(std::size_t(cols) * rows);
+  auto cellOf = [&](sf::Vector2f p) {
+    return std::pair{static_cast<int>((p.x - spawner.min.x) / cell),
+                     static_cast<int>((p.y - spawner.min.y) / cell)};
+  };
+  for (int i = 0; i < points.size(); ++i) {
+    auto [x, y] = cellOf(points[i].position);
+    buckets[std::size_t(y) * cols + x].push_back(i);
+  }
+
+  int violations = 0;
+  for (int i = 0; i < points.size(); ++i) {
+    const auto& a = points[i];
+    if (magnitude(a.position - spawner.exclusionCenter) <
+        spawner.exclusionRadius) {
+      ++violations;
+    }
+    auto [cx, cy] = cellOf(a.position);
+    for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, rows - 1); ++y) {
+      for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, cols - 1); ++x) {
+        for (int j : buckets[std::size_t(y) * cols + x]) {
+          const auto& b = points[j];
+          float allowed = spawner.spacing[a.kind] + spawner.spacing[b.kind];
+          // The tolerance covers float rounding in the spawner's own test
+          if (j > i && magnitude(a.position - b.position) < allowed - 1e-3f) {
+            ++violations;
+          }
+        }
+      }
+    }
+  }
+  return violations;
+}
+
+int main(int argc, char** argv) {
+  unsigned threads = argc > 1 ? std::stoul(argv[1])
+                              : std::thread::hardware_concurrency();
+  int maxCount = argc > 2 ? std::stoi(argv[2]) : 1'000'000;
+
+  WorkerPool pool(threads);
+  WaveSpawner spawner;
+  for (auto size : {Asteroid::SMALL, Asteroid::MEDIUM, Asteroid::BIG}) {
+    spawner.spacing[size] = Asteroid::boundingRadius(size);
+  }
+  spawner.exclusionRadius = 200;
+  spawner.pool = pool.size() > 1 ? &pool : nullptr;
+  print("threads: ", pool.size());
+
+  for (int count = 100; count <= maxCount; count *= 10) {
+    // A tenth big, three tenths medium, the rest small
+    std::array<int, WaveSpawner::MAX_KINDS> counts{};
+    counts[Asteroid::BIG] = count / 10;
+    counts[Asteroid::MEDIUM] = count * 3 / 10;
+    counts[Asteroid::SMALL] = count - counts[Asteroid::BIG] -
+                              counts[Asteroid::MEDIUM];
+
+    // Room for about twice what a saturated pass of each size would need,
+    // in the screen's aspect ratio
+    float area = 0;
+    for (int size = 0; size < WaveSpawner::MAX_KINDS; ++size) {
+      float r = 2 * spawner.spacing[size];
+      area += 2 * counts[size] * 1.5f * r * r;
+    }
+    float height = std::sqrt(area * 9 / 16);
+    spawner.min = {-height * 8 / 9, -height / 2};
+    spawner.max = {height * 8 / 9, height / 2};
+
+    // The first run sizes the buffers, the last timed one is checked
+    spawner.spawn(counts, 0);
+    int runs = std::max(1, 100'000 / count);
+    auto start = now();
+    for (int run = 1; run < runs; ++run) {
+      spawner.spawn(counts, run);
+    }
+    const auto& points = spawner.spawn(counts, runs);
+    std::chrono::duration<double, std::milli> elapsed = now() - start;
+    double ms = elapsed.count() / runs;
+
+    print("asteroids: ", std::setw(8), count, "  placed: ", std::setw(8),
+          points.size(), "  ms/wave: ", std::fixed, std::setprecision(3),
+          std::setw(10), ms, "  ns/asteroid: ", std::setprecision(1),
+          std::setw(7), ms * 1e6 / count,
+          "  violations: ", countViolations(spawner, points));
+  }
+
+  print("spawnWave in a 1920x1080 view:");
+  WaveSpawner waveSpawner;
+  waveSpawner.pool = spawner.pool;
+  for (int count = 10; count <= maxCount / 10; count *= 10) {
+    spawnWave(waveSpawner, count, -960, 960, -540, 540, 0);
+    int runs = std::max(1, 100'000 / count);
+    auto start = now();
+    std::size_t placed = 0;
+    for (int run = 1; run <= runs; ++run) {
+      placed = spawnWave(waveSpawner, count, -960, 960, -540, 540, run).size();
+    }
+    std::chrono::duration<double, std::milli> elapsed = now() - start;
+    double ms = elapsed.count() / runs;
+    print("asteroids: ", std::setw(8), count, "  placed: ", std::setw(8),
+          placed, "  ms/wave: ", std::fixed, std::setprecision(3),
+          std::setw(10), ms, "  ns/asteroid: ", std::setprecision(1),
+          std::setw(7), ms * 1e6 / count, "  spacing: ",
+          waveSpawner.spacing[Asteroid::BIG]);
+  }
+}
@@ -0,0 +1,404 @@
+#pragma once
+
+// Poisson-disk placement for asteroid waves (Bridson, "Fast Poisson Disk
+// Sampling in Arbitrary Dimensions"). Every kind of asteroid keeps a spacing
+// radius clear around its center, so no two spawned asteroids are closer
+// than the sum of their spacings, and nothing spawns in the exclusion zone
+// around the ship.
+//
+// Kinds are placed one pass at a time, widest spacing first, using a
+// background grid with room for one point per cell. A pass is split into
+// square tiles, visited in random order. Each visited tile is filled
+// completely, and the pass stops once the tiles hold twice the requested
+// count, then keeps a random subset. That way a wave is spread over random
+// spots of the whole field instead of growing as a blob around the first
+// point, and the work is linear in the requested count rather than in what
+// would fit in the field. Tiles are sized so a pass visits a few dozen.
+//
+// The tiles are processed in four phases of a 2x2 checkerboard, shuffled
+// within each phase. Tiles of the same phase don't touch and a tile only
+// writes its own cells, so with a WorkerPool they run in parallel without
+// locks. Each tile has its own generator and the tiles run in batches sized
+// from the requested count only, so the result doesn't depend on the number
+// of threads.
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "polygon.hpp"
+#include "worker_pool.hpp"
+
+struct WaveSpawner {
+  static constexpr int MAX_KINDS = 3;
+  // Bridson's k. The paper uses 30; with the candidates spread evenly around
+  // a point 16 fill the field within 2% as densely, in half the time.
+  static constexpr int CANDIDATES = 16;
+  // Tile width in grid cells. Tiles need to be wider than the 2 cells a
+  // lookup reaches, so tiles of the same phase never see each other.
+  static constexpr int MIN_TILE_CELLS = 4;
+  static constexpr int MAX_TILE_CELLS = 32;
+  // Tiles a pass should need at least, so small waves are spread too
+  static constexpr int MIN_TILES = 32;
+  // Points sampled per point kept
+  static constexpr int OVERSAMPLING = 2;
+  // Points per grid cell of a filled tile, about 0.65 / r^2 for Bridson's
+  // algorithm with cells of r^2 / 2
+  static constexpr float FILL_DENSITY = 0.3f;
+  // Rotation between the candidates around a point
+  static constexpr float STEP_COS =
+      static_cast<float>(constexprCos(2 * 3.14159265358979323846 / CANDIDATES));
+  static constexpr float STEP_SIN =
+      static_cast<float>(constexprSin(2 * 3.14159265358979323846 / CANDIDATES));
+
+  struct Point {
+    sf::Vector2f position;
+    int kind;
+  };
+
+  // Background grid, cells are small enough to hold one point. Empty cells
+  // hold a point too far away to matter, so lookups don't branch on them.
+  struct Grid {
+    static constexpr float EMPTY = 1e18f;
+
+    sf::Vector2f origin;
+    float cellSize = 0;
+    int cols = 0;
+    int rows = 0;
+    std::vector<sf::Vector2f> positions;
+
+    void reset(sf::Vector2f min, sf::Vector2f max, float cellSize) {
+      this->origin = min;
+      this->cellSize = cellSize;
+      this->cols =
+          std::max(1, static_cast<int>(std::ceil((max.x - min.x) / cellSize)));
+      this->rows =
+          std::max(1, static_cast<int>(std::ceil((max.y - min.y) / cellSize)));
+      this->positions.assign(std::size_t(cols) * rows, {EMPTY, EMPTY});
+    }
+
+    void clear() {
+      this->cols = this->rows = 0;
+      this->positions.clear();
+    }
+
+    int cellX(float x) const {
+      return std::clamp(static_cast<int>((x - origin.x) / cellSize), 0,
+                        cols - 1);
+    }
+    int cellY(float y) const {
+      return std::clamp(static_cast<int>((y - origin.y) / cellSize), 0,
+                        rows - 1);
+    }
+
+    void insert(sf::Vector2f p) {
+      this->positions[std::size_t(cellY(p.y)) * cols + cellX(p.x)] = p;
+    }
+
+    // Distance from p to the nearest point, or limit if none is closer
+    float nearest(sf::Vector2f p, float limit) const {
+      if (this->positions.empty()) {
+        return limit;
+      }
+      int x0 = cellX(p.x - limit), x1 = cellX(p.x + limit);
+      int y0 = cellY(p.y - limit), y1 = cellY(p.y + limit);
+      float best = limit * limit;
+      for (int y = y0; y <= y1; ++y) {
+        const sf::Vector2f* row = &this->positions[std::size_t(y) * cols];
+        for (int x = x0; x <= x1; ++x) {
+          sf::Vector2f d = row[x] - p;
+          best = std::min(best, d.x * d.x + d.y * d.y);
+        }
+      }
+      return std::sqrt(best);
+    }
+
+    bool isEmpty(sf::Vector2f p) const {
+      return this->positions[std::size_t(cellY(p.y)) * cols + cellX(p.x)].x ==
+             EMPTY;
+    }
+
+    // Whether no point is closer to p than distance
+    bool isClear(sf::Vector2f p, float distance) const {
+      if (this->positions.empty()) {
+        return true;
+      }
+      int x0 = cellX(p.x - distance), x1 = cellX(p.x + distance);
+      int y0 = cellY(p.y - distance), y1 = cellY(p.y + distance);
+      bool clear = true;
+      for (int y = y0; y <= y1; ++y) {
+        const sf::Vector2f* row = &this->positions[std::size_t(y) * cols];
+        for (int x = x0; x <= x1; ++x) {
+          sf::Vector2f d = row[x] - p;
+          clear &= d.x * d.x + d.y * d.y >= distance * distance;
+        }
+      }
+      return clear;
+    }
+  };
+
+  sf::Vector2f min;
+  sf::Vector2f max;
+  std::array<float, MAX_KINDS> spacing{};
+  sf::Vector2f exclusionCenter;
+  float exclusionRadius = 0;
+  WorkerPool* pool = nullptr;  // Tiles run on it when set
+
+  // Buffers are kept between calls and sized by the number of grid cells,
+  // each of which holds at most one point. Spawning the same counts in the
+  // same field again with the pool unset doesn't allocate.
+  std::vector<Point> points;
+  std::array<Grid, MAX_KINDS> placed;  // Chosen points of finished passes
+  Grid sampling;                       // Points of the pass being sampled
+  int tileCells = MAX_TILE_CELLS;
+  int tilesX = 0;
+  std::vector<int> tiles;  // Visiting order
+  std::vector<std::vector<sf::Vector2f>> tilePoints;
+  std::vector<std::vector<sf::Vector2f>> tileActive;
+  std::vector<sf::Vector2f> samples;
+
+  // Up to counts[kind] points of each kind. Fewer are returned for a kind
+  // when no more fit between the points already placed.
+  const std::vector<Point>& spawn(const std::array<int, MAX_KINDS>& counts,
+                                  unsigned seed) {
+    this->points.clear();
+    std::array<int, MAX_KINDS> order;
+    for (int i = 0; i < MAX_KINDS; ++i) {
+      order[i] = i;
+      this->placed[i].clear();
+    }
+    std::sort(order.begin(), order.end(),
+              [&](int a, int b) { return spacing[a] > spacing[b]; });
+
+    for (int kind : order) {
+      if (counts[kind] <= 0) {
+        continue;
+      }
+      sample(kind, seed, std::size_t(OVERSAMPLING) * counts[kind]);
+
+      // Random subset, a partial Fisher-Yates shuffle
+      std::minstd_rand rng(seed * 7919u + kind + 1);
+      auto& samples = this->samples;
+      std::size_t keep = std::min<std::size_t>(counts[kind], samples.size());
+      for (std::size_t i = 0; i < keep; ++i) {
+        std::uniform_int_distribution<std::size_t> pick(i, samples.size() - 1);
+        std::swap(samples[i], samples[pick(rng)]);
+      }
+
+      Grid& grid = this->placed[kind];
+      grid.reset(min, max, 2 * spacing[kind] / std::sqrt(2.f));
+      this->points.reserve(this->points.size() + grid.positions.size());
+      for (std::size_t i = 0; i < keep; ++i) {
+        grid.insert(samples[i]);
+        this->points.push_back({samples[i], kind});
+      }
+    }
+    return this->points;
+  }
+
+  // Adds count points of a kind after spawn() ran out of room for them. They
+  // can't keep their spacing, so each goes to the best of CANDIDATES random
+  // spots outside the exclusion zone, the one overlapping its nearest
+  // neighbour the least. The lookups only reach the cells within the
+  // spacings, so this is linear in the count too.
+  void overflow(int kind, int count, unsigned seed) {
+    std::minstd_rand rng(seed * 7919u + kind + MAX_KINDS + 1);
+    std::uniform_real_distribution<float> randomX(min.x, max.x);
+    std::uniform_real_distribution<float> randomY(min.y, max.y);
+    Grid& grid = this->placed[kind];
+    if (grid.positions.empty()) {
+      grid.reset(min, max, 2 * spacing[kind] / std::sqrt(2.f));
+    }
+    this->points.reserve(this->points.size() + count);
+    for (int i = 0; i < count; ++i) {
+      sf::Vector2f best;
+      // Fraction of the spacing kept to the nearest point, a spot in the
+      // exclusion zone only wins if every candidate is in it
+      float bestScore = -2;
+      for (int k = 0; k < CANDIDATES && bestScore < 1; ++k) {
+        sf::Vector2f p = {randomX(rng), randomY(rng)};
+        sf::Vector2f d = p - exclusionCenter;
+        float score = 1;
+        if (d.x * d.x + d.y * d.y < exclusionRadius * exclusionRadius) {
+          score = -1;
+        }
+        for (int other = 0; other < MAX_KINDS && score > 0; ++other) {
+          float allowed = spacing[kind] + spacing[other];
+          score = std::min(
+              score, this->placed[other].nearest(p, allowed) / allowed);
+        }
+        if (score > bestScore) {
+          best = p;
+          bestScore = score;
+        }
+      }
+      // A cell only holds one point, a spot on top of another is still
+      // returned but not looked up
+      if (grid.isEmpty(best)) {
+        grid.insert(best);
+      }
+      this->points.push_back({best, kind});
+    }
+  }
+
+  // Fills samples with at least count points of a kind, or all that fit,
+  // in visiting order
+  void sample(int kind, unsigned seed, std::size_t count) {
+    Grid& grid = this->sampling;
+    grid.reset(min, max, 2 * spacing[kind] / std::sqrt(2.f));
+    this->tileCells = std::clamp(
+        static_cast<int>(std::sqrt(count / (MIN_TILES * FILL_DENSITY))),
+        MIN_TILE_CELLS, MAX_TILE_CELLS);
+    this->tilesX = (grid.cols + this->tileCells - 1) / this->tileCells;
+    int tilesY = (grid.rows + this->tileCells - 1) / this->tileCells;
+    std::size_t numTiles = std::size_t(this->tilesX) * tilesY;
+    if (this->tilePoints.size() < numTiles) {
+      this->tilePoints.resize(numTiles);
+      this->tileActive.resize(numTiles);
+    }
+
+    // One phase after the other, in random order within each
+    std::minstd_rand rng(seed * 104729u + kind * 31337u);
+    std::array<std::size_t, 4> phaseEnd;
+    this->tiles.clear();
+    this->tiles.reserve(numTiles);
+    for (int phase = 0; phase < 4; ++phase) {
+      std::size_t begin = this->tiles.size();
+      for (int ty = phase / 2; ty < tilesY; ty += 2) {
+        for (int tx = phase % 2; tx < this->tilesX; tx += 2) {
+          this->tiles.push_back(ty * this->tilesX + tx);
+        }
+      }
+      std::shuffle(this->tiles.begin() + begin, this->tiles.end(), rng);
+      phaseEnd[phase] = this->tiles.size();
+    }
+
+    auto fill = [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        fillTile(kind, this->tiles[i],
+                 seed * 104729u + kind * 31337u + this->tiles[i] + 1);
+      }
+    };
+    this->samples.clear();
+    this->samples.reserve(grid.positions.size());
+    std::size_t done = 0;
+    for (int phase = 0; phase < 4 && this->samples.size() < count; ++phase) {
+      while (done < phaseEnd[phase] && this->samples.size() < count) {
+        // As many tiles as should hold the rest, going by the tiles so far
+        float perTile =
+            done > 0 ? static_cast<float>(this->samples.size()) / done
+                     : FILL_DENSITY * this->tileCells * this->tileCells;
+        auto batch = static_cast<std::size_t>(
+            std::ceil((count - this->samples.size()) / std::max(perTile, 1.f)));
+        std::size_t end = std::min(done + batch, phaseEnd[phase]);
+        if (this->pool) {
+          this->pool->run(end - done, [&](std::size_t begin, std::size_t last) {
+            fill(done + begin, done + last);
+          });
+        } else {
+          fill(done, end);
+        }
+        for (; done < end; ++done) {
+          const auto& tile = this->tilePoints[this->tiles[done]];
+          this->samples.insert(this->samples.end(), tile.begin(), tile.end());
+        }
+      }
+    }
+  }
+
+  // Whether a point of this kind can go at p
+  bool isValid(sf::Vector2f p, int kind) const {
+    if (p.x < min.x || p.x >= max.x || p.y < min.y || p.y >= max.y) {
+      return false;
+    }
+    sf::Vector2f d = p - exclusionCenter;
+    if (d.x * d.x + d.y * d.y < exclusionRadius * exclusionRadius) {
+      return false;
+    }
+    // Points of the same pass are the nearest, so they reject the most
+    if (!this->sampling.isClear(p, 2 * spacing[kind])) {
+      return false;
+    }
+    for (int other = 0; other < MAX_KINDS; ++other) {
+      if (!this->placed[other].isClear(p, spacing[kind] + spacing[other])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Bridson's algorithm restricted to one tile. Reseeds until CANDIDATES
+  // random seeds in a row fail, so free areas cut off from the first seed by
+  // earlier points are filled too.
+  void fillTile(int kind, int tile, unsigned seed) {
+    const Grid& grid = this->sampling;
+    float r = 2 * spacing[kind];
+    float tileSize = this->tileCells * grid.cellSize;
+    sf::Vector2f tileMin =
+        grid.origin + sf::Vector2f((tile % this->tilesX) * tileSize,
+                                   (tile / this->tilesX) * tileSize);
+    sf::Vector2f tileMax = {std::min(tileMin.x + tileSize, max.x),
+                            std::min(tileMin.y + tileSize, max.y)};
+    auto inTile = [&](sf::Vector2f p) {
+      return p.x >= tileMin.x && p.x < tileMax.x && p.y >= tileMin.y &&
+             p.y < tileMax.y;
+    };
+
+    std::minstd_rand rng(seed);
+    std::uniform_real_distribution<float> unit(0, 1);
+    auto& out = this->tilePoints[tile];
+    auto& active = this->tileActive[tile];
+    // With at most one point per cell, reserving a tile's worth of cells
+    // means later waves never grow these
+    out.clear();
+    active.clear();
+    out.reserve(this->tileCells * this->tileCells);
+    active.reserve(this->tileCells * this->tileCells);
+    auto add = [&](sf::Vector2f p) {
+      this->sampling.insert(p);
+      out.push_back(p);
+      active.push_back(p);
+    };
+
+    for (int failures = 0; failures < CANDIDATES;) {
+      sf::Vector2f start = {tileMin.x + unit(rng) * (tileMax.x - tileMin.x),
+                            tileMin.y + unit(rng) * (tileMax.y - tileMin.y)};
+      if (!isValid(start, kind)) {
+        ++failures;
+        continue;
+      }
+      failures = 0;
+      add(start);
+
+      while (!active.empty()) {
+        std::size_t i = std::min(
+            static_cast<std::size_t>(unit(rng) * active.size()),
+            active.size() - 1);
+        sf::Vector2f center = active[i];
+        // Candidates are spread evenly around the center from a random
+        // angle, turning a unit vector instead of a sin and cos each
+        float angle = unit(rng) * 2 * 3.14159265f;
+        sf::Vector2f direction(std::cos(angle), std::sin(angle));
+        bool found = false;
+        for (int k = 0; k < CANDIDATES && !found; ++k) {
+          direction = {direction.x * STEP_COS - direction.y * STEP_SIN,
+                       direction.x * STEP_SIN + direction.y * STEP_COS};
+          // Uniform over the annulus between r and 2r
+          float distance = r * std::sqrt(1 + 3 * unit(rng));
+          sf::Vector2f candidate = center + distance * direction;
+          if (inTile(candidate) && isValid(candidate, kind)) {
+            add(candidate);
+            found = true;
+          }
+        }
+        if (!found) {
+          active[i] = active.back();
+          active.pop_back();
+        }
+      }
+    }
+  }
+};
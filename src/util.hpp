@@ -1,9 +1,14 @@
+#pragma once
+
 #include <SFML/Graphics.hpp>
 #include <chrono>
+#include <filesystem>
 #include <iomanip>  // Include this header for std::fixed and std::setprecision
 #include <iostream>
+#include <memory>
 #include <random>
 #include <sstream>
+#include <string_view>
 #include <utility>
 
 /**** Math ****/
@@ -11,6 +16,7 @@
 sf::Vector2f vec(float x, float y) { return {x, y}; }
 
 float to_radians(float degrees) { return degrees * (3.14159265f / 180.f); }
+float to_degrees(float radians) { return radians * (180.f / 3.14159265f); }
 sf::Vector2f move_forward(float degrees, float distance) {
   float radians = to_radians(degrees - 90);
   return {std::cos(radians) * distance, std::sin(radians) * distance};
@@ -51,13 +57,43 @@ sf::Vector2f lerp(const sf::Vector2f& a, const sf::Vector2f& b, float t) {
 
 /**** Printing ****/
 
+// std::ostream writing into a fixed buffer, so text can be formatted every
+// frame without the allocations of a std::stringstream. Output that doesn't
+// fit is dropped.
+struct FormatBuffer : std::streambuf {
+  char data[512];
+  std::ostream stream;
+  std::ios_base::fmtflags defaultFlags;
+
+  FormatBuffer() : stream(this), defaultFlags(stream.flags()) {}
+
+  FormatBuffer(const FormatBuffer&) = delete;
+  FormatBuffer& operator=(const FormatBuffer&) = delete;
+
+  // The view is valid until the next call
+  template <typename... Args>
+  std::string_view format(Args&&... args) {
+    setp(data, data + sizeof(data));
+    // Manipulators like the sf::Vector2f printer's std::fixed stick to the
+    // stream, reset them like a fresh stringstream would have
+    stream.clear();
+    stream.flags(defaultFlags);
+    stream.precision(6);
+    stream.width(0);
+    stream.fill(' ');
+    (stream << ... << std::forward<Args>(args));
+    return {data, static_cast<std::size_t>(pptr() - pbase())};
+  }
+};
+
+FormatBuffer& printBuffer() {
+  static FormatBuffer buffer;
+  return buffer;
+}
+
 template <typename... Args>
 void print(Args&&... args) {
-  std::stringstream ss;
-  (ss << ...
-      << std::forward<Args>(
-             args));  // Fold expression to handle multiple arguments
-  std::cout << ss.str() << std::endl;
+  std::cout << printBuffer().format(std::forward<Args>(args)...) << std::endl;
 }
 
 template <typename T>
@@ -90,11 +126,18 @@ sf::Text makeText(const std::string& str, const sf::Vector2f& pos,
 template <typename Renderable, typename... Args>
 void drawText(Renderable& window, const sf::Vector2f& pos, sf::Font& font,
               Args&&... args) {
-  std::stringstream ss;
-  (ss << ...
-      << std::forward<Args>(
-             args));  // Fold expression to handle multiple arguments
-  window.draw(makeText(ss.str(), pos, font));
+  static FormatBuffer buffer;
+  static sf::Text text = makeText("", pos, font);
+  static std::string shown;
+  // sf::Text::setString converts to UTF-32, only do it when the text changes
+  std::string_view str = buffer.format(std::forward<Args>(args)...);
+  if (str != shown) {
+    shown.assign(str);
+    text.setString(shown);
+  }
+  text.setFont(font);
+  text.setPosition(pos);
+  window.draw(text);
 }
 
 sf::Font loadFont(const std::string& path) {
@@ -134,42 +177,84 @@ struct Line : public sf::Drawable {
   }
 };
 
+// Collects debug drawing during a frame and draws it at the end, layer by
+// layer. Vertices are kept in per-layer buffers that are reused every frame,
+// only draw(std::unique_ptr<sf::Drawable>) allocates.
 struct LayeredDrawer {
-  std::vector<std::vector<std::unique_ptr<sf::Drawable>>> layers;
+  struct Batch {
+    sf::PrimitiveType type;
+    std::size_t first;
+    std::size_t count;
+    int drawable = -1;  // Index into Layer::drawables instead of vertices
+  };
+
+  struct Layer {
+    std::vector<sf::Vertex> vertices;
+    std::vector<Batch> batches;
+    std::vector<std::unique_ptr<sf::Drawable>> drawables;
+  };
+
+  std::vector<Layer> layers;
 
   LayeredDrawer(int numLayers = 1) : layers(numLayers) {}
 
   void draw(std::unique_ptr<sf::Drawable> drawable, int layer = 0) {
-    this->layers[layer].push_back(std::move(drawable));
+    auto& l = this->layers[layer];
+    l.batches.push_back({sf::Points, 0, 0, static_cast<int>(l.drawables.size())});
+    l.drawables.push_back(std::move(drawable));
   }
 
   void draw(const sf::Vertex* vertices, std::size_t vertexCount,
             sf::PrimitiveType type,
             const sf::RenderStates& states = sf::RenderStates::Default,
             int layer = 0) {
-    this->layers[layer].push_back(
-        std::make_unique<Line>(vertices, vertexCount, type));
+    auto& l = this->layers[layer];
+    // Lists of points, lines and triangles can share a batch with the
+    // previous one, strips and fans can't
+    bool isList =
+        type == sf::Points || type == sf::Lines || type == sf::Triangles;
+    if (isList && !l.batches.empty() && l.batches.back().drawable < 0 &&
+        l.batches.back().type == type) {
+      l.batches.back().count += vertexCount;
+    } else {
+      l.batches.push_back({type, l.vertices.size(), vertexCount});
+    }
+    l.vertices.insert(l.vertices.end(), vertices, vertices + vertexCount);
   }
 
   void line(const sf::Vector2f start, const sf::Vector2f end, int layer = 0) {
-    this->layers[layer].push_back(std::make_unique<Line>(start, end));
+    sf::Vertex vertices[2] = {start, end};
+    draw(vertices, 2, sf::Lines, sf::RenderStates::Default, layer);
   }
 
+  // Drawn as the 4x4 square the point's old radius 2 circle was inscribed in
   void point(const sf::Vector2f point, int layer = 0) {
-    std::unique_ptr<sf::CircleShape> circle =
-        std::make_unique<sf::CircleShape>(2);
-    circle->setPosition(point);
-    circle->setFillColor(sf::Color::Red);
-    this->layers[layer].push_back(
-        std::unique_ptr<sf::Drawable>(std::move(circle)));
+    rect(point, {4, 4}, sf::Color::Red, layer);
   }
 
-  void display(sf::RenderWindow& window) {
+  void rect(const sf::Vector2f pos, const sf::Vector2f size,
+            const sf::Color& color, int layer = 0) {
+    sf::Vertex a(pos, color), b(pos + vec(size.x, 0), color),
+        c(pos + size, color), d(pos + vec(0, size.y), color);
+    sf::Vertex vertices[6] = {a, b, c, a, c, d};
+    draw(vertices, 6, sf::Triangles, sf::RenderStates::Default, layer);
+  }
+
+  // Target is an sf::RenderWindow or a CpuRasterizer
+  template <typename Target>
+  void display(Target& window) {
     for (auto& layer : this->layers) {
-      for (const auto& drawable : layer) {
-        window.draw(*drawable);
+      for (const auto& batch : layer.batches) {
+        if (batch.drawable >= 0) {
+          window.draw(*layer.drawables[batch.drawable]);
+        } else {
+          window.draw(layer.vertices.data() + batch.first, batch.count,
+                      batch.type);
+        }
       }
-      layer.clear();
+      layer.vertices.clear();
+      layer.batches.clear();
+      layer.drawables.clear();
     }
   }
 };
@@ -182,35 +267,150 @@ struct TextDrawer {
   };
 
   struct Opts {
-    uint8_t size = 12;
     sf::Vector2f pos;
+    uint8_t size = 12;
   };
 
   sf::Font font;
+  // Slots are kept between frames so their strings and sf::Texts are reused,
+  // only the first count are drawn
   std::vector<Text> texts;
-
+  std::vector<sf::Text> drawables;
+  std::vector<std::string> shown;  // String each sf::Text was last set to
+  std::size_t count = 0;
+  FormatBuffer buffer;
+  sf::String utf32;
+
+  // Without a font, for headless runs where text isn't rendered
+  TextDrawer() = default;
   TextDrawer(const std::string& fontPath) : font(loadFont(fontPath)) {}
 
+  // Creates slots for n texts of up to length characters ahead of time
+  void reserve(std::size_t n, std::size_t length = 64) {
+    if (this->texts.size() < n) {
+      this->texts.resize(n);
+    }
+    // sf::String has no reserve(), setting a string of the full length once
+    // leaves the capacity behind
+    this->utf32.clear();
+    for (std::size_t i = 0; i < length; ++i) {
+      this->utf32 += sf::String(static_cast<sf::Uint32>(' '));
+    }
+    while (this->drawables.size() < n) {
+      this->drawables.push_back(makeText("", {}, font));
+      this->drawables.back().setString(this->utf32);
+      this->drawables.back().setString(sf::String());
+      this->shown.emplace_back();
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      this->texts[i].str.reserve(length);
+      this->shown[i].reserve(length);
+    }
+  }
+
   template <typename... Args>
   void draw(const sf::Vector2f& pos, Args&&... args) {
-    std::stringstream ss;
-    (ss << ... << std::forward<Args>(args));
-    this->texts.push_back({pos, ss.str()});
+    draw(Opts{.pos = pos}, std::forward<Args>(args)...);
   }
 
   template <typename... Args>
   void draw(const Opts& opts, Args&&... args) {
-    std::stringstream ss;
-    (ss << ... << std::forward<Args>(args));
-    this->texts.push_back(
-        {.str = ss.str(), .pos = opts.pos, .size = opts.size});
+    if (this->count == this->texts.size()) {
+      this->texts.emplace_back();
+    }
+    auto& text = this->texts[this->count++];
+    text.pos = opts.pos;
+    text.size = opts.size;
+    text.str.assign(buffer.format(std::forward<Args>(args)...));
+  }
+
+  // Target is an sf::RenderWindow or a CpuRasterizer
+  template <typename Target>
+  void display(Target& window) {
+    for (std::size_t i = 0; i < this->count; ++i) {
+      const auto& text = this->texts[i];
+      if (i >= this->drawables.size()) {
+        this->drawables.push_back(makeText(text.str, text.pos, font, text.size));
+        this->shown.push_back(text.str);
+      }
+      auto& drawable = this->drawables[i];
+      // Converting a std::string to sf::String allocates a temporary, build
+      // the UTF-32 string in reused storage instead
+      if (this->shown[i] != text.str) {
+        this->shown[i].assign(text.str);
+        this->utf32.clear();
+        for (unsigned char c : text.str) {
+          this->utf32 += sf::String(static_cast<sf::Uint32>(c));
+        }
+        drawable.setString(this->utf32);
+      }
+      drawable.setCharacterSize(text.size);
+      drawable.setPosition(text.pos);
+      window.draw(drawable);
+    }
+    this->count = 0;
+  }
+};
+
+/**** Containers ****/
+
+// A vector whose removed elements stay constructed as spares for add() to
+// reuse. Elements are only ever assigned, never moved or destroyed, since
+// sf::Shape has no move constructor and copying one allocates its vertex
+// arrays. Once enough spares exist, add/remove cycles don't allocate.
+template <typename T>
+struct Pool {
+  std::vector<T> items;
+  std::size_t count = 0;
+
+  T* begin() { return this->items.data(); }
+  T* end() { return this->items.data() + this->count; }
+  const T* begin() const { return this->items.data(); }
+  const T* end() const { return this->items.data() + this->count; }
+  std::size_t size() const { return this->count; }
+  bool empty() const { return this->count == 0; }
+  T& operator[](std::size_t i) { return this->items[i]; }
+  const T& operator[](std::size_t i) const { return this->items[i]; }
+
+  void clear() { this->count = 0; }
+
+  // Reinitializes a spare with T::reset(args...), or constructs a new element
+  // from args if there is none
+  template <typename... Args>
+  T& add(Args&&... args) {
+    if (this->count < this->items.size()) {
+      this->items[this->count].reset(std::forward<Args>(args)...);
+    } else {
+      this->items.emplace_back(std::forward<Args>(args)...);
+    }
+    return this->items[this->count++];
   }
 
-  void display(sf::RenderWindow& window) {
-    for (const auto& text : this->texts) {
-      window.draw(makeText(text.str, text.pos, font, text.size));
+  // Constructs spares from args until there are n elements in total
+  template <typename... Args>
+  void reserve(std::size_t n, const Args&... args) {
+    this->items.reserve(n);
+    while (this->items.size() < n) {
+      this->items.emplace_back(args...);
+    }
+  }
+
+  // Removes the elements at the given sorted, unique indices, keeping the
+  // order of the rest
+  void remove(const std::vector<int>& indices) {
+    if (indices.empty()) {
+      return;
+    }
+    std::size_t kept = indices[0];
+    auto next = indices.begin();
+    for (std::size_t i = kept; i < this->count; ++i) {
+      if (next != indices.end() && static_cast<std::size_t>(*next) == i) {
+        ++next;
+        continue;
+      }
+      this->items[kept++] = this->items[i];
     }
-    this->texts.clear();
+    this->count = kept;
   }
 };
 
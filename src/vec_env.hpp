@@ -0,0 +1,390 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "game.hpp"
+#include "polygon.hpp"
+#include "spawner.hpp"
+#include "util.hpp"
+#include "worker_pool.hpp"
+
+/**** Batched Environments ****/
+
+// N independent copies of the game for agent training, stepped together.
+// Each EnvState is a fixed size struct so all of them live in one contiguous
+// vector, and the rules follow main(): the same ship physics and bullet
+// range, and the split, score and round rules from game.hpp. Waves are placed
+// by spawnWave like in main(), each env with its own WaveSpawner, as envs on
+// different threads spawn at the same time. Instead of the game over screen,
+// a hit ends the episode and the env resets right away (as resetFrame does
+// after the timeout).
+//
+// The fixed arrays need limits that main() doesn't have:
+// - Rounds stop growing at MaxRoundAsteroids big asteroids, where main()
+//   adds ROUND_GROWTH per round forever. A big asteroid splits into at most
+//   4 small ones, so MAX_ASTEROIDS is 4 times that and every split fits.
+// - MAX_BULLETS covers a bullet fired every step for a bullet's lifetime,
+//   so SHOOT is never ignored.
+// - An asteroid hit by two bullets in one step splits once, main() splits
+//   it for each bullet.
+// VecEnv uses the default limits, raise MaxRoundAsteroids for agents that
+// get further than round 30.
+template <int MaxRoundAsteroids = 64>
+struct BasicVecEnv {
+  // Action bits, combine with |
+  enum Action : uint8_t {
+    NONE = 0,
+    THRUST = 1 << 0,
+    LEFT = 1 << 1,
+    RIGHT = 1 << 2,
+    SHOOT = 1 << 3,
+  };
+
+  static constexpr int MAX_ROUND_ASTEROIDS = MaxRoundAsteroids;
+  static constexpr int MAX_ASTEROIDS = 4 * MAX_ROUND_ASTEROIDS;
+  // A bullet's lifetime in steps, plus one in case rounding leaves a bullet
+  // a step longer
+  static constexpr int MAX_BULLETS =
+      static_cast<int>(bulletRange / bulletVelocity) + 1;
+  static constexpr int ASTEROID_POINTS = Asteroid::NUM_POINTS;
+  static constexpr int NEAREST_ASTEROIDS = 8;
+  // ship x, y, vx, vy, sin, cos, then per nearest asteroid dx, dy, vx, vy, r
+  static constexpr int OBS_SIZE = 6 + NEAREST_ASTEROIDS * 5;
+
+  // Asteroids never rotate, so only the outline relative to the position is
+  // kept, like Asteroid::outline
+  struct EnvAsteroid {
+    sf::Vector2f position;
+    sf::Vector2f velocity;
+    Asteroid::AsteroidSize size;
+    RadialPolygon<ASTEROID_POINTS> outline;
+  };
+
+  struct EnvBullet {
+    sf::Vector2f position;
+    sf::Vector2f velocity;
+    float range;
+  };
+
+  struct EnvState {
+    sf::Vector2f shipPosition;
+    sf::Vector2f shipVelocity;
+    float shipRotation;
+    long frame;
+    int newRoundFrame;
+    int numAsteroids;
+    uint score;
+    int asteroidCount;
+    int bulletCount;
+    std::minstd_rand rng;
+    EnvAsteroid asteroids[MAX_ASTEROIDS];
+    EnvBullet bullets[MAX_BULLETS];
+  };
+
+  sf::Vector2f viewSize;
+  std::vector<EnvState> envs;
+  std::vector<WaveSpawner> spawners;  // One per env
+  std::vector<float> observations;  // envs.size() * OBS_SIZE
+  std::vector<float> rewards;       // score gained during the last step
+  std::vector<uint8_t> dones;       // 1 if the ship was hit and env reset
+  WorkerPool pool;
+
+  BasicVecEnv(int numEnvs, unsigned seed = 0,
+              unsigned numThreads = std::thread::hardware_concurrency(),
+              sf::Vector2f viewSize = {1920, 1080})
+      : viewSize(viewSize),
+        envs(numEnvs),
+        spawners(numEnvs),
+        observations(std::size_t(numEnvs) * OBS_SIZE),
+        rewards(numEnvs),
+        dones(numEnvs),
+        pool(numThreads) {
+    for (int i = 0; i < numEnvs; ++i) {
+      this->envs[i].rng.seed(seed * 7919u + i + 1);
+      resetEnv(this->envs[i]);
+    }
+    this->pool.run(this->envs.size(), [this](std::size_t begin,
+                                             std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        writeObservation(this->envs[i], &this->observations[i * OBS_SIZE]);
+      }
+    });
+  }
+
+  std::size_t size() const { return envs.size(); }
+
+  // Advances every env by one frame, actions holds one Action mask per env
+  void step(const uint8_t* actions) {
+    this->pool.run(this->envs.size(), [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        EnvState& env = this->envs[i];
+        uint score = env.score;
+        bool hit = stepEnv(env, this->spawners[i], actions[i]);
+        this->rewards[i] = static_cast<float>(env.score - score);
+        this->dones[i] = hit;
+        if (hit) {
+          resetEnv(env);
+        }
+        writeObservation(env, &this->observations[i * OBS_SIZE]);
+      }
+    });
+  }
+
+  /**** Per env logic ****/
+
+  float randomFloat(EnvState& env, float min, float max) {
+    std::uniform_real_distribution<float> dist(min, max);
+    return dist(env.rng);
+  }
+
+  sf::Vector2f randomVector2f(EnvState& env, float minX, float maxX,
+                              float minY, float maxY) {
+    return {randomFloat(env, minX, maxX), randomFloat(env, minY, maxY)};
+  }
+
+  // Same state as main() right after resetFrame: score cleared,
+  // START_ASTEROIDS asteroids, and the next step starts a new round
+  void resetEnv(EnvState& env) {
+    env.shipPosition = {0, 0};
+    env.shipVelocity = {0, 0};
+    env.shipRotation = 0;
+    env.frame = 0;
+    env.newRoundFrame = 0;
+    env.numAsteroids = START_ASTEROIDS;
+    env.score = 0;
+    env.asteroidCount = 0;
+    env.bulletCount = 0;
+  }
+
+  // Splits are added after the hit asteroids are removed, like main() does,
+  // so the count never goes past 4 times the round size
+  void addAsteroid(EnvState& env, sf::Vector2f position, sf::Vector2f velocity,
+                   Asteroid::AsteroidSize size) {
+    EnvAsteroid& asteroid = env.asteroids[env.asteroidCount++];
+    asteroid.position = position;
+    asteroid.velocity = velocity;
+    asteroid.size = size;
+
+    float radius = size == Asteroid::SMALL    ? Asteroid::SMALL_RADIUS
+                   : size == Asteroid::MEDIUM ? Asteroid::MED_RADIUS
+                                              : Asteroid::BIG_RADIUS;
+    std::array<float, ASTEROID_POINTS> radii;
+    for (float& r : radii) {
+      r = radius + randomFloat(env, -radius / 3, radius / 3);
+    }
+    asteroid.outline.setRadii(radii);
+  }
+
+  // Same test as Asteroid::isPointInsideAsteroid
+  static bool isPointInside(const EnvAsteroid& asteroid,
+                            const sf::Vector2f& P) {
+    return asteroid.outline.contains(P - asteroid.position);
+  }
+
+  void wrap(sf::Vector2f& position) const {
+    if (position.x < -viewSize.x / 2) {
+      position.x = viewSize.x / 2;
+    }
+    if (position.x > viewSize.x / 2) {
+      position.x = -viewSize.x / 2;
+    }
+    if (position.y < -viewSize.y / 2) {
+      position.y = viewSize.y / 2;
+    }
+    if (position.y > viewSize.y / 2) {
+      position.y = -viewSize.y / 2;
+    }
+  }
+
+  // One frame of the main() loop, returns true if the ship was hit
+  bool stepEnv(EnvState& env, WaveSpawner& spawner, uint8_t action) {
+    if (roundStarts(env.asteroidCount, env.frame, env.newRoundFrame)) {
+      env.numAsteroids =
+          std::min(env.numAsteroids + ROUND_GROWTH, MAX_ROUND_ASTEROIDS);
+      const auto& wave = spawnWave(
+          spawner, env.numAsteroids, -viewSize.x / 2, viewSize.x / 2,
+          -viewSize.y / 2, viewSize.y / 2, static_cast<unsigned>(env.rng()));
+      for (const auto& point : wave) {
+        addAsteroid(env, point.position, randomVector2f(env, -1, 1, -1, 1),
+                    Asteroid::BIG);
+      }
+      env.bulletCount = 0;
+      env.shipPosition = {0, 0};
+      env.shipVelocity = {0, 0};
+    }
+
+    if ((action & SHOOT) && env.bulletCount < MAX_BULLETS) {
+      env.bullets[env.bulletCount++] = {
+          env.shipPosition, move_forward(env.shipRotation, bulletVelocity),
+          bulletRange};
+    }
+
+    if (action & THRUST) {
+      env.shipVelocity += move_forward(env.shipRotation, shipAcceleration);
+    } else if (env.shipVelocity.x != 0 || env.shipVelocity.y != 0) {
+      env.shipVelocity += normalize(env.shipVelocity) *
+                          -std::min(shipAcceleration / 2,
+                                    magnitude(env.shipVelocity));
+    }
+    if (action & LEFT) {
+      env.shipRotation -= 2;
+    }
+    if (action & RIGHT) {
+      env.shipRotation += 2;
+    }
+    // Kept in [0, 360) like sf::Transformable::setRotation, so long runs of
+    // turning don't lose precision
+    env.shipRotation = std::fmod(env.shipRotation, 360.f);
+    if (env.shipRotation < 0) {
+      env.shipRotation += 360;
+    }
+
+    for (int i = 0; i < env.asteroidCount; ++i) {
+      env.asteroids[i].position += env.asteroids[i].velocity;
+      wrap(env.asteroids[i].position);
+    }
+    env.shipPosition += env.shipVelocity;
+    wrap(env.shipPosition);
+
+    bool bulletDead[MAX_BULLETS] = {};
+    for (int i = 0; i < env.bulletCount; ++i) {
+      EnvBullet& bullet = env.bullets[i];
+      bullet.position += bullet.velocity;
+      wrap(bullet.position);
+      bullet.range -= magnitude(bullet.velocity);
+      bulletDead[i] = bullet.range <= 0;
+    }
+
+    float radians = to_radians(env.shipRotation);
+    float c = std::cos(radians), s = std::sin(radians);
+    for (int i = 0; i < env.asteroidCount; ++i) {
+      for (const auto& p : Ship::HULL.points) {
+        sf::Vector2f pt = env.shipPosition +
+                          vec(c * p.x - s * p.y, s * p.x + c * p.y);
+        if (isPointInside(env.asteroids[i], pt)) {
+          return true;
+        }
+      }
+    }
+
+    // An asteroid hit by two bullets in the same frame only splits once
+    struct Split {
+      sf::Vector2f position;
+      sf::Vector2f velocity;
+      Asteroid::AsteroidSize size;
+    };
+    Split splits[2 * MAX_BULLETS];
+    int splitCount = 0;
+    bool asteroidDead[MAX_ASTEROIDS] = {};
+    // With a bullet fired every step there are dozens of bullets per
+    // asteroid, so the bounding circles are tested from flat arrays first
+    float centerX[MAX_ASTEROIDS], centerY[MAX_ASTEROIDS];
+    float radiusSq[MAX_ASTEROIDS];
+    for (int j = 0; j < env.asteroidCount; ++j) {
+      const EnvAsteroid& asteroid = env.asteroids[j];
+      centerX[j] = asteroid.position.x;
+      centerY[j] = asteroid.position.y;
+      radiusSq[j] = asteroid.outline.maxRadius * asteroid.outline.maxRadius;
+    }
+    for (int i = 0; i < env.bulletCount; ++i) {
+      const sf::Vector2f& P = env.bullets[i].position;
+      for (int j = 0; j < env.asteroidCount; ++j) {
+        float dx = P.x - centerX[j], dy = P.y - centerY[j];
+        if (dx * dx + dy * dy >= radiusSq[j]) {
+          continue;
+        }
+        EnvAsteroid& asteroid = env.asteroids[j];
+        if (asteroidDead[j] || !isPointInside(asteroid, P)) {
+          continue;
+        }
+        env.score += asteroidScore(asteroid.size);
+        splitAsteroid(
+            asteroid.position, asteroid.velocity, asteroid.size,
+            [&](float min, float max) {
+              return randomVector2f(env, min, max, min, max);
+            },
+            [&](sf::Vector2f position, sf::Vector2f velocity,
+                Asteroid::AsteroidSize size) {
+              splits[splitCount++] = {position, velocity, size};
+            });
+        bulletDead[i] = true;
+        asteroidDead[j] = true;
+        break;
+      }
+    }
+
+    // Compact the arrays, keeping order like the erase calls in main()
+    int kept = 0;
+    for (int i = 0; i < env.bulletCount; ++i) {
+      if (!bulletDead[i]) {
+        env.bullets[kept++] = env.bullets[i];
+      }
+    }
+    env.bulletCount = kept;
+    kept = 0;
+    for (int i = 0; i < env.asteroidCount; ++i) {
+      if (!asteroidDead[i]) {
+        env.asteroids[kept++] = env.asteroids[i];
+      }
+    }
+    env.asteroidCount = kept;
+    for (int i = 0; i < splitCount; ++i) {
+      addAsteroid(env, splits[i].position, splits[i].velocity, splits[i].size);
+    }
+
+    ++env.frame;
+    return false;
+  }
+
+  void writeObservation(const EnvState& env, float* obs) const {
+    float halfW = viewSize.x / 2, halfH = viewSize.y / 2;
+    float radians = to_radians(env.shipRotation);
+    obs[0] = env.shipPosition.x / halfW;
+    obs[1] = env.shipPosition.y / halfH;
+    obs[2] = env.shipVelocity.x;
+    obs[3] = env.shipVelocity.y;
+    obs[4] = std::sin(radians);
+    obs[5] = std::cos(radians);
+
+    // Partial selection sort of the nearest asteroids
+    int order[MAX_ASTEROIDS];
+    float distSq[MAX_ASTEROIDS];
+    for (int i = 0; i < env.asteroidCount; ++i) {
+      sf::Vector2f d = env.asteroids[i].position - env.shipPosition;
+      order[i] = i;
+      distSq[i] = d.x * d.x + d.y * d.y;
+    }
+    int nearest = std::min(env.asteroidCount, NEAREST_ASTEROIDS);
+    for (int i = 0; i < nearest; ++i) {
+      int best = i;
+      for (int j = i + 1; j < env.asteroidCount; ++j) {
+        if (distSq[order[j]] < distSq[order[best]]) {
+          best = j;
+        }
+      }
+      std::swap(order[i], order[best]);
+    }
+
+    float* out = obs + 6;
+    for (int i = 0; i < NEAREST_ASTEROIDS; ++i, out += 5) {
+      if (i >= nearest) {
+        std::fill(out, out + 5, 0.f);
+        continue;
+      }
+      const EnvAsteroid& asteroid = env.asteroids[order[i]];
+      out[0] = (asteroid.position.x - env.shipPosition.x) / halfW;
+      out[1] = (asteroid.position.y - env.shipPosition.y) / halfH;
+      out[2] = asteroid.velocity.x;
+      out[3] = asteroid.velocity.y;
+      out[4] = asteroid.outline.maxRadius / Asteroid::BIG_RADIUS;
+    }
+  }
+};
+
+using VecEnv = BasicVecEnv<>;
@@ -0,0 +1,51 @@
+// Benchmark for VecEnv: steps a batch of environments with random actions and
+// reports env-steps per second.
+//
+// Usage: vec_env_bench [envs] [steps] [threads]
+
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util.hpp"
+#include "vec_env.hpp"
+
+int main(int argc, char** argv) {
+  int numEnvs = argc > 1 ? std::stoi(argv[1]) : 4096;
+  int steps = argc > 2 ? std::stoi(argv[2]) : 1000;
+  unsigned threads = argc > 3 ? std::stoul(argv[3])
+                              : std::thread::hardware_concurrency();
+
+  VecEnv env(numEnvs, 0, threads);
+  print("envs: ", numEnvs, "  threads: ", env.pool.size(),
+        "  obs size: ", VecEnv::OBS_SIZE);
+
+  // Pre-generate actions so the timing only covers stepping
+  std::default_random_engine engine;
+  std::uniform_int_distribution<int> dist(0, 15);
+  std::vector<uint8_t> actions(std::size_t(numEnvs) * 64);
+  for (auto& action : actions) {
+    action = static_cast<uint8_t>(dist(engine));
+  }
+
+  long episodes = 0;
+  double totalReward = 0;
+  auto start = now();
+  for (int s = 0; s < steps; ++s) {
+    env.step(&actions[std::size_t(s % 64) * numEnvs]);
+    for (int i = 0; i < numEnvs; ++i) {
+      episodes += env.dones[i];
+      totalReward += env.rewards[i];
+    }
+  }
+  std::chrono::duration<double> elapsed = now() - start;
+
+  print("steps/sec: ", long(double(numEnvs) * steps / elapsed.count()),
+        "  episodes: ", episodes,
+        "  mean reward/step: ", std::setprecision(4),
+        totalReward / (double(numEnvs) * steps));
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent threads for splitting a loop over [0, count) into chunks.
+// The calling thread works on the first chunk, so a pool of 1 thread never
+// starts a worker.
+struct WorkerPool {
+  using Job = std::function<void(std::size_t begin, std::size_t end)>;
+
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable finished;
+  const Job* job = nullptr;
+  std::size_t jobCount = 0;
+  unsigned generation = 0;
+  unsigned pending = 0;
+  bool stopping = false;
+
+  explicit WorkerPool(unsigned numThreads = std::thread::hardware_concurrency()) {
+    numThreads = std::max(1u, numThreads);
+    for (unsigned i = 1; i < numThreads; ++i) {
+      this->threads.emplace_back([this, i] { worker(i); });
+    }
+  }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : this->threads) {
+      thread.join();
+    }
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  unsigned size() const { return static_cast<unsigned>(threads.size()) + 1; }
+
+  // Calls fn on disjoint chunks covering [0, count) and waits for all of them
+  void run(std::size_t count, const Job& fn) {
+    if (this->threads.empty() || count < 2) {
+      fn(0, count);
+      return;
+    }
+    {
+      std::lock_guard lock(mutex);
+      job = &fn;
+      jobCount = count;
+      pending = static_cast<unsigned>(threads.size());
+      ++generation;
+    }
+    wake.notify_all();
+
+    auto [begin, end] = chunk(0, count);
+    fn(begin, end);
+
+    std::unique_lock lock(mutex);
+    finished.wait(lock, [this] { return pending == 0; });
+    job = nullptr;
+  }
+
+  std::pair<std::size_t, std::size_t> chunk(unsigned index,
+                                            std::size_t count) const {
+    return {count * index / size(), count * (index + 1) / size()};
+  }
+
+  void worker(unsigned index) {
+    unsigned seen = 0;
+    while (true) {
+      const Job* current;
+      std::size_t count;
+      {
+        std::unique_lock lock(mutex);
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) {
+          return;
+        }
+        seen = generation;
+        current = job;
+        count = jobCount;
+      }
+
+      auto [begin, end] = chunk(index, count);
+      if (begin < end) {
+        (*current)(begin, end);
+      }
+
+      {
+        std::lock_guard lock(mutex);
+        --pending;
+      }
+      finished.notify_one();
+    }
+  }
+};